@@ -14,9 +14,14 @@ if(UNIX)
     target_link_libraries(${PROJECT} LINK_PRIVATE "${BOOST_LIB_DIR}/libboost_system.a")
     target_link_libraries(${PROJECT} LINK_PRIVATE "${BOOST_LIB_DIR}/libboost_program_options.a")
     target_link_libraries(${PROJECT} LINK_PRIVATE "${BOOST_LIB_DIR}/libboost_regex.a")
+    target_link_libraries(${PROJECT} LINK_PRIVATE "${BOOST_LIB_DIR}/libboost_iostreams.a")
+    target_link_libraries(${PROJECT} LINK_PRIVATE z)
+
+    if(WITH_ZSTD)
+        target_link_libraries(${PROJECT} LINK_PRIVATE zstd)
+    endif()
 
     if(UNIT_TEST)
         target_link_libraries(${PROJECT} LINK_PRIVATE "${BOOST_LIB_DIR}/libboost_unit_test_framework.a")
-        target_link_libraries(${PROJECT} LINK_PRIVATE "${BOOST_LIB_DIR}/libboost_iostreams.a")
     endif()
 endif()
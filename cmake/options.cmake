@@ -18,3 +18,10 @@ if(WIN32)
 endif()
 
 add_definitions(-DDETAILED_STATS=1) # if 1, print detailed times
+
+# if ON, -z decompresses zstd files, needs boost iostreams with zstd support
+option(WITH_ZSTD "Search in zstd compressed files" OFF)
+
+if(WITH_ZSTD)
+    add_definitions(-DWITH_ZSTD=1)
+endif()
@@ -8,10 +8,13 @@ unix {
     LIBS += $${BOOST_LIB_DIR}/libboost_filesystem.a
     LIBS += $${BOOST_LIB_DIR}/libboost_system.a
     LIBS += $${BOOST_LIB_DIR}/libboost_program_options.a
+    LIBS += $${BOOST_LIB_DIR}/libboost_iostreams.a
+    LIBS += -lz
+
+    with_zstd: LIBS += -lzstd
 
     unit_test {
         LIBS += $${BOOST_LIB_DIR}/libboost_unit_test_framework.a
-        LIBS += $${BOOST_LIB_DIR}/libboost_iostreams.a
     }
 }
 
@@ -10,6 +10,28 @@ HEADERS += $${SRC_DIR}/types.hpp
 HEADERS += $${SRC_DIR}/utils.hpp
 SOURCES += $${SRC_DIR}/utils.cpp
 
+HEADERS += $${SRC_DIR}/encoding.hpp
+SOURCES += $${SRC_DIR}/encoding.cpp
+
+HEADERS += $${SRC_DIR}/compression.hpp
+SOURCES += $${SRC_DIR}/compression.cpp
+
+HEADERS += $${SRC_DIR}/archive.hpp
+SOURCES += $${SRC_DIR}/archive.cpp
+
+HEADERS += $${SRC_DIR}/glob.hpp
+SOURCES += $${SRC_DIR}/glob.cpp
+HEADERS += $${SRC_DIR}/gitignore.hpp
+SOURCES += $${SRC_DIR}/gitignore.cpp
+HEADERS += $${SRC_DIR}/filter.hpp
+SOURCES += $${SRC_DIR}/filter.cpp
+HEADERS += $${SRC_DIR}/dedup.hpp
+SOURCES += $${SRC_DIR}/dedup.cpp
+HEADERS += $${SRC_DIR}/gitindex.hpp
+SOURCES += $${SRC_DIR}/gitindex.cpp
+HEADERS += $${SRC_DIR}/gitobjects.hpp
+SOURCES += $${SRC_DIR}/gitobjects.cpp
+
 HEADERS += $${SRC_DIR}/pipes.hpp
 SOURCES += $${SRC_DIR}/pipes.cpp
 
@@ -24,11 +46,14 @@ HEADERS += $${SRC_DIR}/stopwatch.hpp
 HEADERS += $${SRC_DIR}/exitqueue.hpp
 HEADERS += $${SRC_DIR}/threadpool.hpp
 SOURCES += $${SRC_DIR}/threadpool.cpp
+HEADERS += $${SRC_DIR}/pipeline.hpp
+SOURCES += $${SRC_DIR}/pipeline.cpp
 
 HEADERS += $${SRC_DIR}/printer/printer.hpp
 HEADERS += $${SRC_DIR}/printer/prettyprinter.hpp
 HEADERS += $${SRC_DIR}/printer/htmlprinter.hpp
 HEADERS += $${SRC_DIR}/printer/pipedprinter.hpp
+HEADERS += $${SRC_DIR}/printer/hexprinter.hpp
 HEADERS += $${SRC_DIR}/printer/printerfactory.hpp
 
 macx:   SOURCES += $${SRC_DIR}/macutils.mm
@@ -16,3 +16,6 @@ linux: DEFINES += 'FIND_ALGO=FIND_STRSTR'
 win32: DEFINES += 'FIND_ALGO=FIND_STRSTR'
 
 DEFINES += 'DETAILED_STATS=1'       # if 1, print detailed times
+
+# with_zstd, -z decompresses zstd files, needs boost iostreams with zstd support
+with_zstd: DEFINES += 'WITH_ZSTD=1'
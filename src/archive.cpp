@@ -0,0 +1,276 @@
+#include "archive.hpp"
+
+#include <algorithm>
+
+#include "compression.hpp"
+
+namespace {
+
+constexpr size_t tarBlock = 512;
+
+//! \returns little endian integer at ptr
+template<class T>
+inline T get( const char* ptr ) {
+    T value;
+    memcpy( &value, ptr, sizeof( T ) );
+    return value;
+}
+
+//! \returns numeric tar header field, octal or base-256 for GNU large sizes
+uint64_t tarNumber( const char* field, const size_t size ) {
+    uint64_t value = 0;
+
+    if( field[0] & 0x80 ) {
+        value = field[0] & 0x7F;
+
+        for( size_t i = 1; i < size; ++i ) {
+            value = ( value << 8 ) | uint8_t( field[i] );
+        }
+
+        return value;
+    }
+
+    size_t i = 0;
+
+    while( i < size && field[i] == ' ' ) { ++i; }
+
+    for( ; i < size && field[i] >= '0' && field[i] <= '7'; ++i ) {
+        value = ( value << 3 ) | ( field[i] - '0' );
+    }
+
+    return value;
+}
+
+//! \returns string of a fixed size header field, which may lack the \0
+inline std::string tarString( const char* field, const size_t size ) {
+    return std::string( field, strnlen( field, size ) );
+}
+
+//! parses the "length key=value\n" records of a pax header for path and size
+void paxRecords( std::string_view records, std::string& path, uint64_t& size ) {
+    while( !records.empty() ) {
+        size_t space = records.find( ' ' );
+        size_t length = strtoull( records.data(), nullptr, 10 );
+
+        if( space == std::string_view::npos || length <= space || length > records.size() ) { return; }
+
+        std::string_view record = records.substr( space + 1, length - space - 2 );
+        size_t equals = record.find( '=' );
+
+        if( equals != std::string_view::npos ) {
+            std::string_view key = record.substr( 0, equals );
+            std::string_view value = record.substr( equals + 1 );
+
+            if( key == "path" ) { path = value; }
+
+            if( key == "size" ) { size = strtoull( std::string( value ).c_str(), nullptr, 10 ); }
+        }
+
+        records.remove_prefix( length );
+    }
+}
+
+//! copies member into out, so searchers may read behind its end
+//! \returns false, if there is not enough memory
+inline bool copy( const char* ptr, const size_t size, utils::Buffer& out ) {
+    if( !out.grow( size ) ) { return false; }
+
+    memcpy( out.ptr, ptr, size );
+    return true;
+}
+
+bool walkTar( const std::string_view& content, utils::Buffer& out,
+              const std::function<void( const std::string&, const std::string_view& )>& callback ) {
+    // set by GNU long name and pax headers for the next member
+    std::string nextPath;
+    uint64_t nextSize = 0;
+    bool hasNextSize = false;
+
+    for( size_t pos = 0; pos + tarBlock <= content.size(); ) {
+        const char* header = content.data() + pos;
+
+        // end of archive
+        if( !header[0] ) { break; }
+
+        uint64_t size = tarNumber( header + 124, 12 );
+        const char type = header[156];
+
+        if( hasNextSize && type != 'L' && type != 'x' ) { size = nextSize; }
+
+        const size_t data = pos + tarBlock;
+
+        if( size > content.size() - data ) { return false; }
+
+        pos = data + ( size + tarBlock - 1 ) / tarBlock * tarBlock;
+        const char* ptr = content.data() + data;
+
+        switch( type ) {
+            case 'L':
+                nextPath = tarString( ptr, size );
+                continue;
+
+            case 'x': {
+                uint64_t paxSize = 0;
+                paxRecords( std::string_view( ptr, size ), nextPath, paxSize );
+                hasNextSize = paxSize != 0;
+                nextSize = paxSize;
+                continue;
+            }
+
+            case '0':
+            case '7':
+            case '\0': {
+                std::string name = nextPath;
+
+                if( name.empty() ) {
+                    name = tarString( header, 100 );
+
+                    // POSIX ustar splits long names into prefix and name
+                    if( !memcmp( header + 257, "ustar\0", 6 ) && header[345] ) {
+                        name = tarString( header + 345, 155 ) + "/" + name;
+                    }
+                }
+
+                if( !copy( ptr, size, out ) ) { return false; }
+
+                callback( name, std::string_view( out.ptr, out.size ) );
+                break;
+            }
+
+            default:
+                // directories, links, devices and global pax headers
+                break;
+        }
+
+        nextPath.clear();
+        hasNextSize = false;
+    }
+
+    return true;
+}
+
+bool walkZip( const std::string_view& content, utils::Buffer& out,
+              const std::function<void( const std::string&, const std::string_view& )>& callback ) {
+    const char* begin = content.data();
+    const size_t eocdSize = 22;
+
+    // true, if length bytes from pos are within content
+    auto inside = [&content]( const uint64_t pos, const uint64_t length ) {
+        return pos <= content.size() && length <= content.size() - pos;
+    };
+
+    if( content.size() < eocdSize ) { return false; }
+
+    // end of central directory record, behind it only a comment of at most 64 kB
+    size_t eocd = content.size() - eocdSize;
+    const size_t last = eocd > 0xFFFF ? eocd - 0xFFFF : 0;
+
+    while( memcmp( begin + eocd, "PK\x05\x06", 4 ) ) {
+        if( eocd == last ) { return false; }
+
+        --eocd;
+    }
+
+    uint64_t entries = get<uint16_t>( begin + eocd + 10 );
+    uint64_t offset = get<uint32_t>( begin + eocd + 16 );
+
+    // zip64 locator in front of the record
+    if( ( entries == 0xFFFF || offset == 0xFFFFFFFF ) && eocd >= 20 && !memcmp( begin + eocd - 20, "PK\x06\x07", 4 ) ) {
+        uint64_t eocd64 = get<uint64_t>( begin + eocd - 20 + 8 );
+
+        if( !inside( eocd64, 56 ) || memcmp( begin + eocd64, "PK\x06\x06", 4 ) ) { return false; }
+
+        entries = get<uint64_t>( begin + eocd64 + 32 );
+        offset = get<uint64_t>( begin + eocd64 + 48 );
+    }
+
+    for( uint64_t i = 0; i < entries; ++i ) {
+        if( !inside( offset, 46 ) || memcmp( begin + offset, "PK\x01\x02", 4 ) ) { return false; }
+
+        const char* entry = begin + offset;
+        const uint16_t flags = get<uint16_t>( entry + 8 );
+        const uint16_t method = get<uint16_t>( entry + 10 );
+        uint64_t compressed = get<uint32_t>( entry + 20 );
+        uint64_t size = get<uint32_t>( entry + 24 );
+        const uint16_t nameLength = get<uint16_t>( entry + 28 );
+        const uint16_t extraLength = get<uint16_t>( entry + 30 );
+        const uint16_t commentLength = get<uint16_t>( entry + 32 );
+        uint64_t local = get<uint32_t>( entry + 42 );
+
+        offset += 46 + nameLength + extraLength + commentLength;
+
+        if( offset > content.size() ) { return false; }
+
+        std::string name( entry + 46, nameLength );
+
+        // zip64 extra field has the 64 bit values of all saturated fields in this order
+        const char* extras = entry + 46 + nameLength + extraLength;
+
+        for( const char* extra = entry + 46 + nameLength; extra + 4 <= extras; ) {
+            const uint16_t id = get<uint16_t>( extra );
+            const uint16_t length = get<uint16_t>( extra + 2 );
+            const char* field = extra + 4;
+            const char* end = std::min( field + length, extras );
+
+            if( id == 0x0001 ) {
+                for( uint64_t* value : { &size, &compressed, &local } ) {
+                    if( *value == 0xFFFFFFFF && field + 8 <= end ) {
+                        *value = get<uint64_t>( field );
+                        field += 8;
+                    }
+                }
+            }
+
+            extra = end;
+        }
+
+        // directories and encrypted entries
+        if( name.empty() || name.back() == '/' || ( flags & 1 ) ) { continue; }
+
+        if( !inside( local, 30 ) || memcmp( begin + local, "PK\x03\x04", 4 ) ) { return false; }
+
+        const uint64_t data = local + 30 + get<uint16_t>( begin + local + 26 ) + get<uint16_t>( begin + local + 28 );
+
+        if( !inside( data, compressed ) ) { return false; }
+
+        const std::string_view stream( begin + data, compressed );
+
+        if( method == 0 ) {
+            if( !copy( stream.data(), stream.size(), out ) ) { return false; }
+
+            callback( name, std::string_view( out.ptr, out.size ) );
+        } else if( method == 8 ) {
+            if( !compression::decompress( compression::Format::Deflate, stream, out ) ) { return false; }
+
+            callback( name, std::string_view( out.ptr, out.size ) );
+        }
+
+        // other methods like bzip2 or lzma are skipped
+    }
+
+    return true;
+}
+
+}
+
+archive::Format archive::detect( const std::string_view& content ) {
+    if( content.size() >= 4 && ( !memcmp( content.data(), "PK\x03\x04", 4 ) || !memcmp( content.data(), "PK\x05\x06", 4 ) ) ) {
+        return Format::Zip;
+    }
+
+    // ustar\0 for POSIX, ustar followed by two spaces for GNU tar
+    if( content.size() >= tarBlock && !memcmp( content.data() + 257, "ustar", 5 ) ) { return Format::Tar; }
+
+    return Format::None;
+}
+
+bool archive::walk( const std::string_view& content, utils::Buffer& out,
+                    const std::function<void( const std::string& name, const std::string_view& member )>& callback ) {
+    switch( detect( content ) ) {
+        case Format::Tar: return walkTar( content, out, callback );
+
+        case Format::Zip: return walkZip( content, out, callback );
+
+        default: return false;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+
+#include "utils.hpp"
+
+namespace archive {
+
+enum class Format {
+    None,
+    Tar, // ustar, GNU and pax
+    Zip  // stored and deflated entries, zip64
+};
+
+//! separates the archive path from the member name in printed paths
+constexpr char separator = '!';
+
+//! \returns format by the magic number of content
+Format detect( const std::string_view& content );
+
+//! calls callback with name and content of each regular file in the archive
+//! \note member content is copied or inflated into out, so it is aligned and zero padded like a read file
+//! \returns false, if the archive is corrupt
+bool walk( const std::string_view& content, utils::Buffer& out,
+           const std::function<void( const std::string& name, const std::string_view& member )>& callback );
+
+}
@@ -0,0 +1,122 @@
+#include "compression.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "boost/iostreams/filtering_streambuf.hpp"
+#include "boost/iostreams/device/array.hpp"
+#include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filter/zlib.hpp"
+#if WITH_ZSTD
+#include "boost/iostreams/filter/zstd.hpp"
+#endif
+
+namespace io = boost::iostreams;
+
+compression::Format compression::detect( const std::string_view& content ) {
+    if( content.size() >= 2 && !memcmp( content.data(), "\x1F\x8B", 2 ) ) { return Format::Gzip; }
+
+    if( content.size() >= 4 && !memcmp( content.data(), "\x28\xB5\x2F\xFD", 4 ) ) { return Format::Zstd; }
+
+    return Format::None;
+}
+
+bool compression::isSupported( const Format format ) {
+    switch( format ) {
+        case Format::Gzip: return true;
+
+        case Format::Deflate: return true;
+
+        case Format::Zlib: return true;
+#if WITH_ZSTD
+
+        case Format::Zstd: return true;
+#endif
+
+        default: return false;
+    }
+}
+
+struct compression::Stream::Impl {
+    io::filtering_istreambuf stream;
+};
+
+compression::Stream::Stream( const Format format, const std::string_view& content ) {
+    if( !isSupported( format ) ) { return; }
+
+    impl = std::make_unique<Impl>();
+
+    if( format == Format::Gzip ) {
+        impl->stream.push( io::gzip_decompressor() );
+    }
+
+    if( format == Format::Deflate ) {
+        io::zlib_params params;
+        params.noheader = true;
+        impl->stream.push( io::zlib_decompressor( params ) );
+    }
+
+    if( format == Format::Zlib ) {
+        impl->stream.push( io::zlib_decompressor() );
+    }
+
+#if WITH_ZSTD
+
+    if( format == Format::Zstd ) {
+        impl->stream.push( io::zstd_decompressor() );
+    }
+
+#endif
+    impl->stream.push( io::array_source( content.data(), content.size() ) );
+}
+
+compression::Stream::~Stream() = default;
+
+bool compression::Stream::read( utils::Buffer& out, const size_t bytes ) {
+    if( !impl ) { return false; }
+
+    const size_t chunk = 64_kB;
+    const size_t wanted = out.size + std::min( bytes, SIZE_MAX - out.size );
+    size_t read = out.size;
+
+    try {
+        while( read < wanted ) {
+            // double, but not beyond the wanted size
+            if( out.reserved == read ) {
+                out.size = read;
+
+                if( !out.extend( std::min( std::max( 2 * out.reserved, chunk ), wanted ) ) ) { return false; }
+            }
+
+            std::streamsize got = impl->stream.sgetn( out.ptr + read, std::min( { chunk, out.reserved - read, wanted - read } ) );
+
+            if( got <= 0 ) {
+                end = true;
+                break;
+            }
+
+            read += got;
+        }
+    } catch( const std::ios_base::failure& ) {
+        // gzip and zstd errors
+        out.size = read;
+        return false;
+    }
+
+    out.size = read;
+    memset( out.ptr + read, 0, 16 );
+    return true;
+}
+
+bool compression::decompress( const Format format, const std::string_view& content, utils::Buffer& out, const size_t size ) {
+    // start with the known size plus one byte to see the end,
+    // else with 4 times the compressed size, and double if needed
+    if( !out.grow( size ? size + 1 : std::max<size_t>( 4 * content.size(), 64_kB ) ) ) { return false; }
+
+    out.size = 0;
+    Stream stream( format, content );
+
+    if( !stream.read( out, SIZE_MAX ) ) { return false; }
+
+    return !size || out.size == size;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "utils.hpp"
+
+namespace compression {
+
+enum class Format {
+    None,
+    Gzip,
+    Zstd,
+    Deflate, // raw deflate stream without header, as in zip files
+    Zlib     // deflate stream with zlib header, as in git objects
+};
+
+//! \returns format by the magic number at the start of content
+Format detect( const std::string_view& content );
+
+//! \returns true, if fsrc was built with support for format
+bool isSupported( const Format format );
+
+//! decompresses content in chunks into out
+//! \param size decompressed size, if known, else 0
+//! \note stops at the end of the compressed stream, so content may be longer
+//! \returns false, if content is corrupt, format is not supported or there is not enough memory
+bool decompress( const Format format, const std::string_view& content, utils::Buffer& out, const size_t size = 0 );
+
+//! decompresses content piece by piece, so outputs larger than the memory can be searched in chunks
+class Stream {
+    public:
+        Stream( const Format format, const std::string_view& content );
+        Stream( const Stream& ) = delete;
+        Stream& operator=( const Stream& ) = delete;
+        ~Stream();
+
+        //! appends up to bytes of output to the first out.size bytes of out, which grows as needed
+        //! \returns false, if content is corrupt, format is not supported or there is not enough memory
+        bool read( utils::Buffer& out, const size_t bytes );
+
+        //! \returns true, once read reached the end of the compressed stream
+        bool finished() const { return end; }
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl; // nullptr, if the format is not supported
+        bool end = false;
+};
+
+}
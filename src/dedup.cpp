@@ -0,0 +1,83 @@
+#include "dedup.hpp"
+
+#include <functional>
+
+void dedup::Result::set( const std::vector<search::Match>& found, const std::string_view& content, const bool isBinary ) {
+    binary = isBinary;
+    matches.reserve( found.size() );
+
+    for( const search::Match& match : found ) {
+        matches.emplace_back( match.first - content.cbegin(), match.second - content.cbegin() );
+    }
+
+    done.store( true, std::memory_order_release );
+}
+
+std::vector<search::Match> dedup::Result::get( const std::string_view& content ) const {
+    std::vector<search::Match> found;
+    found.reserve( matches.size() );
+
+    for( const auto& [from, to] : matches ) {
+        found.emplace_back( content.cbegin() + from, content.cbegin() + to );
+    }
+
+    return found;
+}
+
+size_t dedup::Index::KeyHash::operator()( const Key& key ) const {
+    return std::hash<uint64_t>()( key.first * 0x9E3779B97F4A7C15ull ^ key.second );
+}
+
+dedup::Index::Shard& dedup::Index::shard( std::array<Shard, 64>& shards, const Key& key ) {
+    return shards[KeyHash()( key ) % shards.size()];
+}
+
+dedup::ResultPtr dedup::Index::byInode( const uint64_t dev, const uint64_t ino ) {
+    const Key key( dev, ino );
+    Shard& inode = shard( inodes, key );
+    std::unique_lock<std::mutex> lock( inode.m );
+    const auto it = inode.results.find( key );
+    return it == inode.results.cend() ? nullptr : it->second;
+}
+
+dedup::ResultPtr dedup::Index::byContent( const std::string_view& content, const uint64_t dev, const uint64_t ino, bool& first ) {
+    // the size makes collisions of the 64 bit hash even less likely, the bytes are compared anyway
+    const Key key( content.size(), std::hash<std::string_view>()( content ) );
+    Shard& same = shard( contents, key );
+    ResultPtr result;
+    first = false;
+
+    {
+        std::unique_lock<std::mutex> lock( same.m );
+        const auto it = same.results.find( key );
+
+        if( it != same.results.cend() ) { result = it->second; }
+    }
+
+    if( !result ) {
+        if( kept.fetch_add( content.size() ) + content.size() > maxKept ) {
+            kept -= content.size();
+            return nullptr;
+        }
+
+        // copied outside of the lock, the content of a published result is not changed anymore
+        ResultPtr fresh = std::make_shared<Result>();
+        fresh->content = content;
+
+        std::unique_lock<std::mutex> lock( same.m );
+        const auto [it, inserted] = same.results.emplace( key, fresh );
+        first = inserted;
+        result = it->second;
+
+        if( !first ) { kept -= content.size(); }
+    }
+
+    if( !first && result->content != content ) { return nullptr; }
+
+    if( !dev && !ino ) { return result; }
+
+    Shard& inode = shard( inodes, Key( dev, ino ) );
+    std::unique_lock<std::mutex> lock( inode.m );
+    inode.results.emplace( Key( dev, ino ), result );
+    return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+#include "utils.hpp"
+
+namespace dedup {
+
+//! matches of one content as offsets, so they apply to each file with this content
+struct Result {
+    std::atomic_bool done = {false}; // set by the first searcher of the content, after matches and binary
+    bool binary = false;
+    std::vector<std::pair<size_t, size_t>> matches;
+    std::string content; // copy of the first content, compared with each later one of the same key
+
+    //! stores matches as offsets into content and sets done
+    void set( const std::vector<search::Match>& found, const std::string_view& content, const bool isBinary );
+    //! \returns matches as iterators into content, which must be equal to the searched one
+    std::vector<search::Match> get( const std::string_view& content ) const;
+};
+
+using ResultPtr = std::shared_ptr<Result>;
+
+//! results of the searched contents, found by device and inode for hardlinks, or by size and hash of the content
+//! \note thread safe, the maps are sharded, so the workers rarely wait for each other
+class Index {
+    public:
+        //! total size of the kept contents, later contents are searched without deduplication
+        static constexpr size_t maxKept = 512_MB;
+
+        //! \returns result of an earlier file with the same device and inode, or nullptr
+        ResultPtr byInode( const uint64_t dev, const uint64_t ino );
+
+        //! \returns result of an earlier file with the same content, or a new one, with first = true,
+        //! which the caller fills, the result is also registered for dev and ino, unless both are 0,
+        //! or nullptr, if the hash collides with another content or maxKept is reached
+        ResultPtr byContent( const std::string_view& content, const uint64_t dev, const uint64_t ino, bool& first );
+
+    private:
+        using Key = std::pair<uint64_t, uint64_t>;
+
+        struct KeyHash {
+            size_t operator()( const Key& key ) const;
+        };
+
+        struct alignas( 64 ) Shard {
+            std::mutex m;
+            std::unordered_map<Key, ResultPtr, KeyHash> results;
+        };
+
+        std::array<Shard, 64> inodes;
+        std::array<Shard, 64> contents;
+        std::atomic<size_t> kept = {0};
+
+        //! \returns shard of key in shards
+        static Shard& shard( std::array<Shard, 64>& shards, const Key& key );
+};
+
+}
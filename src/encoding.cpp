@@ -0,0 +1,332 @@
+#include "encoding.hpp"
+
+#include <bitset>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <emmintrin.h>
+
+namespace {
+
+struct Counts {
+    size_t zerosEven = 0; // \0 at even offsets
+    size_t zerosOdd = 0;  // \0 at odd offsets
+    size_t controls = 0;  // control chars, which are unusual in text
+    bool highBit = false; // non ASCII chars
+};
+
+inline size_t popcount( const int mask ) {
+    return std::bitset<16>( mask ).count();
+}
+
+inline bool isControl( const unsigned char c ) {
+    return c != 0 && c < 0x20 && !( c >= '\t' && c <= '\r' ) && c != 0x1B;
+}
+
+Counts count( const unsigned char* data, const size_t size ) {
+    Counts counts;
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i x1f   = _mm_set1_epi8( 0x1F );
+    const __m128i tab   = _mm_set1_epi8( '\t' );
+    const __m128i four  = _mm_set1_epi8( '\r' - '\t' );
+    const __m128i esc   = _mm_set1_epi8( 0x1B );
+    int high = 0;
+    size_t pos = 0;
+
+    for( ; pos + 16 <= size; pos += 16 ) {
+        const __m128i text16 = _mm_loadu_si128( ( __m128i const* )( data + pos ) );
+
+        // pos is even, so are the even bits in the mask
+        const int zeros = _mm_movemask_epi8( _mm_cmpeq_epi8( text16, zero ) );
+        counts.zerosEven += popcount( zeros & 0x5555 );
+        counts.zerosOdd  += popcount( zeros & 0xAAAA );
+
+        // chars <= 0x1F, without \t\n\v\f\r and ESC
+        const __m128i low = _mm_cmpeq_epi8( _mm_min_epu8( text16, x1f ), text16 );
+        const __m128i shifted = _mm_sub_epi8( text16, tab );
+        const __m128i space = _mm_cmpeq_epi8( _mm_min_epu8( shifted, four ), shifted );
+        const __m128i ignored = _mm_or_si128( space, _mm_cmpeq_epi8( text16, esc ) );
+        const int controls = _mm_movemask_epi8( _mm_andnot_si128( ignored, low ) );
+        counts.controls += popcount( controls & ~zeros );
+
+        high |= _mm_movemask_epi8( text16 );
+    }
+
+    for( ; pos < size; ++pos ) {
+        const unsigned char c = data[pos];
+
+        if( c == 0 ) {
+            if( pos % 2 ) { counts.zerosOdd++; } else { counts.zerosEven++; }
+        }
+
+        if( isControl( c ) ) { counts.controls++; }
+
+        high |= c & 0x80;
+    }
+
+    counts.highBit = high != 0;
+    return counts;
+}
+
+//! magic numbers of binaries, which might have no \0 in the first block
+//! \sa https://en.wikipedia.org/wiki/List_of_file_signatures
+const std::string_view magics[] = {
+    "%PDF",             // PDF
+    "%!PS",             // PostScript
+    "\x7F" "ELF",       // ELF
+    "\x89PNG",          // PNG
+    "GIF8",             // GIF
+    "\xFF\xD8\xFF",     // JPEG
+    "PK\x03\x04",       // zip, jar, docx
+    "\x1F\x8B",         // gzip
+    "\x28\xB5\x2F\xFD", // zstd
+    "BZh",              // bzip2
+    "\xFD" "7zXZ",      // xz
+};
+
+}
+
+bool encoding::isUTF8( const char* text, const size_t size, const bool truncated ) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>( text );
+    size_t pos = 0;
+
+    while( pos < size ) {
+        // skip ASCII in 16 byte steps
+        if( pos + 16 <= size ) {
+            const __m128i text16 = _mm_loadu_si128( ( __m128i const* )( data + pos ) );
+
+            if( !_mm_movemask_epi8( text16 ) ) {
+                pos += 16;
+                continue;
+            }
+        }
+
+        const unsigned char c = data[pos];
+
+        if( c < 0x80 ) { ++pos; continue; }
+
+        size_t length = 0;
+        unsigned char min = 0x80; // range of the 2nd byte, which excludes overlongs and surrogates
+        unsigned char max = 0xBF;
+
+        if( c >= 0xC2 && c <= 0xDF ) {
+            length = 2;
+        } else if( c >= 0xE0 && c <= 0xEF ) {
+            length = 3;
+
+            if( c == 0xE0 ) { min = 0xA0; }
+
+            if( c == 0xED ) { max = 0x9F; }
+        } else if( c >= 0xF0 && c <= 0xF4 ) {
+            length = 4;
+
+            if( c == 0xF0 ) { min = 0x90; }
+
+            if( c == 0xF4 ) { max = 0x8F; }
+        } else {
+            return false;
+        }
+
+        for( size_t i = 1; i < length; ++i ) {
+            if( pos + i >= size ) { return truncated; }
+
+            const unsigned char next = data[pos + i];
+
+            if( i == 1 ? ( next < min || next > max ) : ( next & 0xC0 ) != 0x80 ) {
+                return false;
+            }
+        }
+
+        pos += length;
+    }
+
+    return true;
+}
+
+encoding::Encoding encoding::classify( const std::string_view& content ) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>( content.data() );
+    const size_t size = std::min( content.size(), blockSize );
+
+    // byte order marks
+    if( size >= 3 && !memcmp( data, "\xEF\xBB\xBF", 3 ) ) { return Encoding::UTF8; }
+
+    if( size >= 2 && !memcmp( data, "\xFE\xFF", 2 ) ) { return Encoding::UTF16BE; }
+
+    if( size >= 2 && !memcmp( data, "\xFF\xFE", 2 ) ) {
+        // UTF-32LE starts with FF FE 00 00
+        if( size >= 4 && !data[2] && !data[3] ) { return Encoding::Binary; }
+
+        return Encoding::UTF16LE;
+    }
+
+    for( const std::string_view& magic : magics ) {
+        if( size >= magic.size() && !memcmp( data, magic.data(), magic.size() ) ) {
+            return Encoding::Binary;
+        }
+    }
+
+    const Counts counts = count( data, size );
+
+    if( counts.zerosEven || counts.zerosOdd ) {
+        // UTF-16 without BOM, where ASCII chars have a \0 in every 2nd byte
+        const size_t pairs = size / 2;
+
+        if( counts.zerosOdd >= pairs / 2 && counts.zerosEven * 16 <= counts.zerosOdd ) { return Encoding::UTF16LE; }
+
+        if( counts.zerosEven >= pairs / 2 && counts.zerosOdd * 16 <= counts.zerosEven ) { return Encoding::UTF16BE; }
+
+        return Encoding::Binary;
+    }
+
+    // more than 3% control chars
+    if( counts.controls * 32 > size ) { return Encoding::Binary; }
+
+    if( !counts.highBit ) { return Encoding::UTF8; }
+
+    // a block might end within a multibyte char
+    const bool truncated = content.size() > size;
+    return isUTF8( content.data(), size, truncated ) ? Encoding::UTF8 : Encoding::Latin1;
+}
+
+size_t encoding::transcodedSize( const Encoding encoding, const size_t size ) {
+    switch( encoding ) {
+        // 2 bytes become max 3 bytes, surrogate pairs 4 bytes become 4 bytes
+        case Encoding::UTF16LE:
+        case Encoding::UTF16BE:
+            return size / 2 * 3 + 3;
+
+        // 0x80-0xFF become 2 bytes
+        case Encoding::Latin1:
+            return size * 2;
+
+        default:
+            return size;
+    }
+}
+
+namespace {
+
+inline char* putUTF8( char* out, const uint32_t code ) {
+    if( code < 0x80 ) {
+        *out++ = char( code );
+    } else if( code < 0x800 ) {
+        *out++ = char( 0xC0 | ( code >> 6 ) );
+        *out++ = char( 0x80 | ( code & 0x3F ) );
+    } else if( code < 0x10000 ) {
+        *out++ = char( 0xE0 | ( code >> 12 ) );
+        *out++ = char( 0x80 | ( ( code >> 6 ) & 0x3F ) );
+        *out++ = char( 0x80 | ( code & 0x3F ) );
+    } else {
+        *out++ = char( 0xF0 | ( code >> 18 ) );
+        *out++ = char( 0x80 | ( ( code >> 12 ) & 0x3F ) );
+        *out++ = char( 0x80 | ( ( code >> 6 ) & 0x3F ) );
+        *out++ = char( 0x80 | ( code & 0x3F ) );
+    }
+
+    return out;
+}
+
+template<bool bigEndian>
+inline uint16_t unit( const unsigned char* in ) {
+    return bigEndian ? uint16_t( in[0] << 8 | in[1] ) : uint16_t( in[1] << 8 | in[0] );
+}
+
+template<bool bigEndian>
+size_t fromUTF16( const unsigned char* in, size_t size, char* out ) {
+    char* start = out;
+    const unsigned char* end = in + ( size & ~size_t( 1 ) );
+
+    // drop BOM
+    if( end - in >= 2 && unit<bigEndian>( in ) == 0xFEFF ) { in += 2; }
+
+    const __m128i nonAscii = _mm_set1_epi16( short( 0xFF80 ) );
+    const __m128i zero = _mm_setzero_si128();
+
+    while( in < end ) {
+        // 16 ASCII chars in 32 bytes are packed to 16 bytes
+        if( end - in >= 32 ) {
+            __m128i a = _mm_loadu_si128( ( __m128i const* )in );
+            __m128i b = _mm_loadu_si128( ( __m128i const* )( in + 16 ) );
+
+            if( bigEndian ) {
+                a = _mm_or_si128( _mm_slli_epi16( a, 8 ), _mm_srli_epi16( a, 8 ) );
+                b = _mm_or_si128( _mm_slli_epi16( b, 8 ), _mm_srli_epi16( b, 8 ) );
+            }
+
+            const __m128i high = _mm_and_si128( _mm_or_si128( a, b ), nonAscii );
+
+            if( _mm_movemask_epi8( _mm_cmpeq_epi8( high, zero ) ) == 0xFFFF ) {
+                _mm_storeu_si128( ( __m128i* )out, _mm_packus_epi16( a, b ) );
+                in += 32;
+                out += 16;
+                continue;
+            }
+        }
+
+        uint32_t code = unit<bigEndian>( in );
+        in += 2;
+
+        if( code >= 0xD800 && code <= 0xDBFF ) {
+            // high surrogate, needs a low one
+            if( end - in >= 2 ) {
+                const uint32_t low = unit<bigEndian>( in );
+
+                if( low >= 0xDC00 && low <= 0xDFFF ) {
+                    code = 0x10000 + ( ( code - 0xD800 ) << 10 ) + ( low - 0xDC00 );
+                    in += 2;
+                } else {
+                    code = 0xFFFD;
+                }
+            } else {
+                code = 0xFFFD;
+            }
+        } else if( code >= 0xDC00 && code <= 0xDFFF ) {
+            code = 0xFFFD;
+        }
+
+        out = putUTF8( out, code );
+    }
+
+    return out - start;
+}
+
+size_t fromLatin1( const unsigned char* in, const size_t size, char* out ) {
+    char* start = out;
+    const unsigned char* end = in + size;
+
+    while( in < end ) {
+        // copy ASCII in 16 byte steps
+        if( end - in >= 16 ) {
+            const __m128i text16 = _mm_loadu_si128( ( __m128i const* )in );
+
+            if( !_mm_movemask_epi8( text16 ) ) {
+                _mm_storeu_si128( ( __m128i* )out, text16 );
+                in += 16;
+                out += 16;
+                continue;
+            }
+        }
+
+        out = putUTF8( out, *in++ );
+    }
+
+    return out - start;
+}
+
+}
+
+size_t encoding::toUTF8( const Encoding encoding, const char* in, const size_t size, char* out ) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>( in );
+
+    switch( encoding ) {
+        case Encoding::UTF16LE: return fromUTF16<false>( data, size, out );
+
+        case Encoding::UTF16BE: return fromUTF16<true>( data, size, out );
+
+        case Encoding::Latin1: return fromLatin1( data, size, out );
+
+        default:
+            memcpy( out, in, size );
+            return size;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string_view>
+
+namespace encoding {
+
+enum class Encoding {
+    Binary,
+    UTF8,    // or plain ASCII
+    Latin1,  // no valid UTF-8, but no control chars either
+    UTF16LE,
+    UTF16BE
+};
+
+//! only the first block of a file is classified
+constexpr size_t blockSize = 4096;
+
+//! classifies the first blockSize bytes of content with sse2
+//! \note like git, a single \0 makes a file binary, unless it looks like UTF-16
+Encoding classify( const std::string_view& content );
+
+//! \returns true, if data is valid UTF-8
+//! \param truncated if true, an incomplete sequence at the end is valid
+bool isUTF8( const char* data, const size_t size, const bool truncated = false );
+
+//! \returns true, if content is searchable as it is
+inline bool isAsciiCompatible( const Encoding encoding ) {
+    return encoding == Encoding::UTF8 || encoding == Encoding::Latin1;
+}
+
+//! \returns true, if content must be transcoded to UTF-8 before searching
+inline bool needsTranscoding( const Encoding encoding ) {
+    return encoding != Encoding::UTF8 && encoding != Encoding::Binary;
+}
+
+//! \returns max size of size bytes in encoding transcoded to UTF-8
+size_t transcodedSize( const Encoding encoding, const size_t size );
+
+//! transcodes UTF-16 or Latin-1 to UTF-8 with an sse2 fast path for ASCII
+//! \note UTF-16 BOMs are dropped, unpaired surrogates become U+FFFD
+//! \param out must have space for transcodedSize( encoding, size ) bytes
+//! \returns bytes written to out
+size_t toUTF8( const Encoding encoding, const char* in, const size_t size, char* out );
+
+}
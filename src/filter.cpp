@@ -0,0 +1,168 @@
+#include "filter.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+//! globs of the file types of -t and -T
+const std::map<std::string, std::vector<std::string>>& types() {
+    static const std::map<std::string, std::vector<std::string>> types = {
+        { "asm", { "*.asm", "*.s", "*.S" } },
+        { "c", { "*.c", "*.h" } },
+        { "cmake", { "CMakeLists.txt", "*.cmake" } },
+        { "cpp", { "*.cpp", "*.cc", "*.cxx", "*.c++", "*.hpp", "*.hh", "*.hxx", "*.h++", "*.h", "*.inl", "*.ipp" } },
+        { "cs", { "*.cs" } },
+        { "css", { "*.css", "*.scss", "*.sass", "*.less" } },
+        { "go", { "*.go" } },
+        { "html", { "*.html", "*.htm", "*.xhtml" } },
+        { "java", { "*.java" } },
+        { "js", { "*.js", "*.jsx", "*.mjs", "*.cjs", "*.vue" } },
+        { "json", { "*.json" } },
+        { "kotlin", { "*.kt", "*.kts" } },
+        { "lua", { "*.lua" } },
+        { "make", { "Makefile", "makefile", "GNUmakefile", "*.mk", "*.mak" } },
+        { "md", { "*.md", "*.markdown" } },
+        { "objc", { "*.m", "*.mm", "*.h" } },
+        { "perl", { "*.pl", "*.pm", "*.t" } },
+        { "php", { "*.php" } },
+        { "py", { "*.py", "*.pyi" } },
+        { "qmake", { "*.pro", "*.pri", "*.prf" } },
+        { "rb", { "*.rb", "Gemfile", "Rakefile", "*.gemspec" } },
+        { "rust", { "*.rs" } },
+        { "sh", { "*.sh", "*.bash", "*.zsh", ".bashrc", ".zshrc", ".profile" } },
+        { "sql", { "*.sql" } },
+        { "swift", { "*.swift" } },
+        { "toml", { "*.toml" } },
+        { "ts", { "*.ts", "*.tsx", "*.mts", "*.cts" } },
+        { "txt", { "*.txt" } },
+        { "xml", { "*.xml", "*.xsd", "*.xsl", "*.svg" } },
+        { "yaml", { "*.yaml", "*.yml" } },
+    };
+
+    return types;
+}
+
+//! adds the globs of each type to patterns
+void addTypes( filter::Patterns& patterns, const std::vector<std::string>& names ) {
+    for( const std::string& name : names ) {
+        const auto type = types().find( name );
+
+        if( type == types().cend() ) { continue; }
+
+        for( const std::string& glob : type->second ) {
+            for( const gitignore::Pattern& pattern : gitignore::parse( glob ) ) {
+                patterns.add( pattern );
+            }
+        }
+    }
+}
+
+//! \returns last component of path
+std::string_view filename( const std::string_view& path ) {
+    const size_t slash = path.rfind( '/' );
+    return slash == std::string_view::npos ? path : path.substr( slash + 1 );
+}
+
+}
+
+void filter::Patterns::add( const gitignore::Pattern& pattern ) {
+    if( pattern.anchored || pattern.dirOnly || pattern.kind == gitignore::Pattern::Kind::Glob ) {
+        globs.push_back( pattern );
+    } else if( pattern.kind == gitignore::Pattern::Kind::Literal ) {
+        names.insert( pattern.glob );
+    } else {
+        const std::string suffix = pattern.glob.substr( 1 );
+        suffixes.insert( suffix );
+
+        if( std::find( suffixSizes.cbegin(), suffixSizes.cend(), suffix.size() ) == suffixSizes.cend() ) {
+            suffixSizes.push_back( suffix.size() );
+            std::sort( suffixSizes.begin(), suffixSizes.end(), std::greater<size_t>() );
+        }
+    }
+}
+
+bool filter::Patterns::matches( const std::string_view& path, const std::string_view& name, const bool isDir ) const {
+    if( !names.empty() && names.count( std::string( name ) ) ) { return true; }
+
+    for( const size_t size : suffixSizes ) {
+        if( size <= name.size() && suffixes.count( std::string( name.substr( name.size() - size ) ) ) ) { return true; }
+    }
+
+    for( const gitignore::Pattern& pattern : globs ) {
+        if( pattern.matches( path, name, isDir ) ) { return true; }
+    }
+
+    return false;
+}
+
+bool filter::Filter::file( const std::string_view& path, const bool parents ) const {
+    const std::string_view name = filename( path );
+
+    if( excludeGlobs.matches( path, name, false ) || excludeTypes.matches( path, name, false ) ) { return false; }
+
+    // the walkers don't descend into excluded directories, but the index and trees list all files
+    if( parents ) {
+        for( size_t slash = path.find( '/' ); slash != std::string_view::npos; slash = path.find( '/', slash + 1 ) ) {
+            if( !dir( path.substr( 0, slash ) ) ) { return false; }
+        }
+    }
+
+    if( !includeGlobs.empty() && !includeGlobs.matches( path, name, false ) ) { return false; }
+
+    return includeTypes.empty() || includeTypes.matches( path, name, false );
+}
+
+bool filter::Filter::dir( const std::string_view& path ) const {
+    return !excludeGlobs.matches( path, filename( path ), true );
+}
+
+bool filter::Filter::listedFile( const sys_string& filename ) const {
+    return file( gitignore::relative( filename, root ) );
+}
+
+bool filter::Filter::listedDir( const sys_string& dirname ) const {
+    return dir( gitignore::relative( dirname, root ) );
+}
+
+filter::FilterPtr filter::compile( const std::vector<std::string>& globs, const std::vector<std::string>& types,
+                                   const std::vector<std::string>& notTypes, const sys_string& root ) {
+    if( globs.empty() && types.empty() && notTypes.empty() ) { return nullptr; }
+
+    auto filter = std::make_shared<Filter>();
+    filter->root = root.size() + ( root.back() == '/' || root.back() == '\\' ? 0 : 1 );
+
+    for( const std::string& glob : globs ) {
+        for( gitignore::Pattern& pattern : gitignore::parse( glob ) ) {
+            // like in ripgrep, a leading ! excludes
+            const bool exclude = pattern.negated;
+            pattern.negated = false;
+            ( exclude ? filter->excludeGlobs : filter->includeGlobs ).add( pattern );
+        }
+    }
+
+    addTypes( filter->includeTypes, types );
+    addTypes( filter->excludeTypes, notTypes );
+
+    return filter;
+}
+
+bool filter::isType( const std::string& name ) {
+    return types().count( name );
+}
+
+std::string filter::typeList() {
+    std::string list;
+
+    for( const auto& [name, globs] : types() ) {
+        list += name + ":";
+
+        for( const std::string& glob : globs ) {
+            list += ( &glob == &globs.front() ? " " : ", " ) + glob;
+        }
+
+        list += "\n";
+    }
+
+    return list;
+}
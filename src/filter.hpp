@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "gitignore.hpp"
+
+namespace filter {
+
+//! patterns of one kind compiled into lookup tables, so most names are matched with a few hash lookups
+struct Patterns {
+    std::unordered_set<std::string> names;    // literal names like CMakeLists.txt
+    std::unordered_set<std::string> suffixes; // suffixes of *.ext like .min.js, without the *
+    std::vector<size_t> suffixSizes;          // distinct sizes of suffixes, longest first
+    std::vector<gitignore::Pattern> globs;    // anchored, directory only and other globs
+
+    void add( const gitignore::Pattern& pattern );
+    bool empty() const { return names.empty() && suffixes.empty() && globs.empty(); }
+
+    //! \param path relative to the search folder with / as separator
+    //! \param name last component of path
+    bool matches( const std::string_view& path, const std::string_view& name, const bool isDir ) const;
+};
+
+//! include and exclude globs of -g and file types of -t and -T, evaluated by the walkers before any open
+//! \note immutable after compile, so the workers can share it
+struct Filter {
+    size_t root = 0; // size of the search folder including its trailing separator
+    Patterns includeGlobs;
+    Patterns includeTypes;
+    Patterns excludeGlobs; // !glob, also prune directories
+    Patterns excludeTypes; // -T, files only
+
+    //! \param path relative to the search folder with / as separator
+    //! \param parents check the directories of path against the exclude globs, too, for paths which were not walked
+    //! \returns true, if the file at path is searched
+    bool file( const std::string_view& path, const bool parents = false ) const;
+
+    //! \returns true, if the walker descends into the directory at path
+    bool dir( const std::string_view& path ) const;
+
+    //! like file and dir, but with a path as listed by the walker, which starts with the search folder
+    bool listedFile( const sys_string& filename ) const;
+    bool listedDir( const sys_string& dirname ) const;
+};
+
+using FilterPtr = std::shared_ptr<const Filter>;
+
+//! \param globs like *.cpp or src/**, excluding with a leading !
+//! \param types names of file types to search like cpp
+//! \param notTypes names of file types to skip
+//! \param root search folder, to which the globs are relative
+//! \returns nullptr, if there is nothing to filter
+FilterPtr compile( const std::vector<std::string>& globs, const std::vector<std::string>& types,
+                   const std::vector<std::string>& notTypes, const sys_string& root );
+
+//! \returns true, if name is a known file type
+bool isType( const std::string& name );
+
+//! \returns known file types with their globs like "cpp: *.cpp, *.hpp, ..." one per line
+std::string typeList();
+
+}
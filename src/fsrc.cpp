@@ -21,7 +21,17 @@ int main( int argc, char* argv[] ) {
     std::function<Printer*()> makePrinter = printerfactory::printerFunc( opts );
     Searcher searcher( opts, makePrinter );
 
-    if( !opts.noGit && fs::exists( opts.path / ".git" ) ) {
+    const bool isRepo = fs::exists( opts.path / ".git" );
+
+    // --rev and --changed need a repo
+    if( ( !opts.rev.empty() || !opts.changedSince.empty() ) && !isRepo ) {
+        printf( "\"%s\" is not a git repo.\n", opts.path.string().c_str() );
+        exit( -1 );
+    }
+
+    if( !opts.rev.empty() ) {
+        searcher.onRevFiles();
+    } else if( isRepo && ( !opts.noGit || !opts.changedSince.empty() ) ) {
         // set prefix for clickable paths
         opts.prefix = utils::absolutePath( opts.path.native() );
 
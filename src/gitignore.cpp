@@ -0,0 +1,225 @@
+#include "gitignore.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+#include "boost/algorithm/string/predicate.hpp"
+
+#include "gitindex.hpp"
+#include "glob.hpp"
+
+namespace {
+
+//! \returns content of filename or an empty string
+std::string readFile( const fs::path& filename ) {
+    std::ifstream file( filename.native(), std::ios::binary );
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+//! \returns value without surrounding whitespace and quotes
+std::string_view trim( std::string_view value ) {
+    while( !value.empty() && isspace( static_cast<unsigned char>( value.front() ) ) ) { value.remove_prefix( 1 ); }
+
+    while( !value.empty() && isspace( static_cast<unsigned char>( value.back() ) ) ) { value.remove_suffix( 1 ); }
+
+    if( value.size() >= 2 && value.front() == '"' && value.back() == '"' ) { value = value.substr( 1, value.size() - 2 ); }
+
+    return value;
+}
+
+//! \returns value of core.excludesFile in the git config file, or an empty string
+std::string excludesFile( const fs::path& config ) {
+    std::istringstream lines( readFile( config ) );
+    std::string line;
+    std::string value;
+    bool core = false;
+
+    while( std::getline( lines, line ) ) {
+        std::string_view trimmed = trim( line );
+
+        if( trimmed.empty() || trimmed.front() == '#' || trimmed.front() == ';' ) { continue; }
+
+        if( trimmed.front() == '[' ) {
+            core = boost::algorithm::iequals( trimmed, "[core]" );
+            continue;
+        }
+
+        size_t equals = trimmed.find( '=' );
+
+        if( core && equals != std::string_view::npos && boost::algorithm::iequals( trim( trimmed.substr( 0, equals ) ), "excludesfile" ) ) {
+            value = trim( trimmed.substr( equals + 1 ) );
+        }
+    }
+
+    // ~/ is expanded by git
+    const char* home = getenv( "HOME" );
+
+    if( home && value.size() >= 2 && value[0] == '~' && value[1] == '/' ) {
+        value = home + value.substr( 1 );
+    }
+
+    return value;
+}
+
+//! \returns rules of the patterns in content chained to parent, or parent, if there are none
+gitignore::RulesPtr chain( const gitignore::RulesPtr& parent, const std::string_view& content, const std::string& base ) {
+    std::vector<gitignore::Pattern> patterns = gitignore::parse( content );
+
+    if( patterns.empty() ) { return parent; }
+
+    auto rules = std::make_shared<gitignore::Rules>();
+    rules->parent = parent;
+    rules->base = base;
+    rules->patterns = std::move( patterns );
+    return rules;
+}
+
+}
+
+bool gitignore::Pattern::matches( const std::string_view& path, const std::string_view& name, const bool isDir ) const {
+    if( dirOnly && !isDir ) { return false; }
+
+    if( anchored ) {
+        return kind == Kind::Literal ? path == glob : glob::match( glob, path );
+    }
+
+    switch( kind ) {
+        case Kind::Literal:
+            return name == glob;
+
+        case Kind::Suffix:
+            return name.size() >= glob.size() - 1 &&
+                   !name.compare( name.size() - ( glob.size() - 1 ), glob.size() - 1, std::string_view( glob ).substr( 1 ) );
+
+        default:
+            return glob::match( glob, name );
+    }
+}
+
+std::vector<gitignore::Pattern> gitignore::parse( const std::string_view& content ) {
+    std::vector<Pattern> patterns;
+    size_t from = 0;
+
+    while( from < content.size() ) {
+        size_t to = content.find( '\n', from );
+
+        if( to == std::string_view::npos ) { to = content.size(); }
+
+        std::string_view line = content.substr( from, to - from );
+        from = to + 1;
+
+        if( !line.empty() && line.back() == '\r' ) { line.remove_suffix( 1 ); }
+
+        // trailing spaces are ignored, unless escaped
+        while( !line.empty() && line.back() == ' ' && !( line.size() >= 2 && line[line.size() - 2] == '\\' ) ) {
+            line.remove_suffix( 1 );
+        }
+
+        if( line.empty() || line.front() == '#' ) { continue; }
+
+        Pattern pattern;
+
+        if( line.front() == '!' ) {
+            pattern.negated = true;
+            line.remove_prefix( 1 );
+        }
+
+        if( !line.empty() && line.back() == '/' ) {
+            pattern.dirOnly = true;
+            line.remove_suffix( 1 );
+        }
+
+        // a / at the start or in the middle anchors the pattern
+        if( line.find( '/' ) != std::string_view::npos ) {
+            pattern.anchored = true;
+
+            if( line.front() == '/' ) { line.remove_prefix( 1 ); }
+        }
+
+        if( line.empty() ) { continue; }
+
+        pattern.glob = line;
+
+        if( !glob::hasWildcards( line ) ) {
+            pattern.kind = Pattern::Kind::Literal;
+        } else if( line.front() == '*' && !glob::hasWildcards( line.substr( 1 ) ) ) {
+            pattern.kind = Pattern::Kind::Suffix;
+        }
+
+        patterns.push_back( std::move( pattern ) );
+    }
+
+    return patterns;
+}
+
+bool gitignore::Rules::ignored( const std::string_view& path, const bool isDir ) const {
+    const size_t slash = path.rfind( '/' );
+    const std::string_view name = slash == std::string_view::npos ? path : path.substr( slash + 1 );
+
+    for( const Rules* rules = this; rules; rules = rules->parent.get() ) {
+        // ignore files apply to their own directory only
+        if( path.compare( 0, rules->base.size(), rules->base ) ) { continue; }
+
+        const std::string_view inBase = path.substr( rules->base.size() );
+
+        for( auto pattern = rules->patterns.crbegin(); pattern != rules->patterns.crend(); ++pattern ) {
+            if( pattern->matches( inBase, name, isDir ) ) { return !pattern->negated; }
+        }
+    }
+
+    return false;
+}
+
+gitignore::RulesPtr gitignore::fromRepo( const fs::path& root ) {
+    RulesPtr rules;
+
+    // core.excludesFile from the repo config overrides the global one
+    std::string global = excludesFile( gitindex::gitDir( root ) / "config" );
+
+    if( global.empty() ) {
+        const char* home = getenv( "HOME" );
+        const char* xdg = getenv( "XDG_CONFIG_HOME" );
+
+        if( home ) { global = excludesFile( fs::path( home ) / ".gitconfig" ); }
+
+        if( global.empty() && xdg ) { global = excludesFile( fs::path( xdg ) / "git" / "config" ); }
+
+        if( global.empty() && xdg ) { global = ( fs::path( xdg ) / "git" / "ignore" ).string(); }
+
+        if( global.empty() && home ) { global = ( fs::path( home ) / ".config" / "git" / "ignore" ).string(); }
+    }
+
+    if( !global.empty() ) { rules = chain( rules, readFile( global ), "" ); }
+
+    return chain( rules, readFile( gitindex::gitDir( root ) / "info" / "exclude" ), "" );
+}
+
+gitignore::RulesPtr gitignore::load( const RulesPtr& parent, const sys_string& filename, const std::string& base ) {
+    return chain( parent, readFile( filename ), base );
+}
+
+bool gitignore::isIgnoreFile( const sys_string& filename ) {
+    static const sys_string name = fs::path( ".gitignore" ).native();
+
+    if( filename.size() <= name.size() ) { return false; }
+
+    const sys_string::value_type separator = filename[filename.size() - name.size() - 1];
+    return ( separator == '/' || separator == '\\' ) && !filename.compare( filename.size() - name.size(), name.size(), name );
+}
+
+std::string gitignore::relative( const sys_string& path, const size_t root ) {
+    if( path.size() <= root ) { return std::string(); }
+
+    std::string relative( path.cbegin() + root, path.cend() );
+#if BOOST_OS_WINDOWS
+    std::replace( relative.begin(), relative.end(), '\\', '/' );
+#endif
+
+    if( !relative.empty() && relative.back() == '/' ) { relative.pop_back(); }
+
+    return relative;
+}
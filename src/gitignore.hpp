@@ -0,0 +1,120 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace gitignore {
+
+//! one line of an ignore file
+struct Pattern {
+    enum class Kind {
+        Literal, // name without wildcards like build
+        Suffix,  // name with a leading * only like *.o
+        Glob     // everything else, matched with glob::match
+    };
+
+    std::string glob;      // without !, leading and trailing /
+    Kind kind = Kind::Glob;
+    bool negated = false;  // !pattern re-includes
+    bool dirOnly = false;  // pattern/ matches directories only
+    bool anchored = false; // has a /, so it matches the path relative to the ignore file, else the name
+
+    //! \param path relative to the directory of the ignore file
+    //! \param name last component of path
+    bool matches( const std::string_view& path, const std::string_view& name, const bool isDir ) const;
+};
+
+//! \returns patterns of the lines of an ignore file
+std::vector<Pattern> parse( const std::string_view& content );
+
+//! patterns of one ignore file, chained to the patterns of the parent directories
+//! \note immutable, so the workers of a parallel walk can share them
+struct Rules {
+    std::shared_ptr<const Rules> parent;
+    std::string base; // directory of the ignore file relative to the root, empty or with trailing /
+    std::vector<Pattern> patterns;
+
+    //! the last matching pattern of the deepest ignore file wins, like in git
+    //! \param path relative to the root, with / as separator
+    //! \returns true, if path is ignored
+    bool ignored( const std::string_view& path, const bool isDir ) const;
+};
+
+using RulesPtr = std::shared_ptr<const Rules>;
+
+//! \returns rules from core.excludesFile and .git/info/exclude of the repo in root, or nullptr
+RulesPtr fromRepo( const fs::path& root );
+
+//! \returns rules of the ignore file chained to parent, or parent, if the file has no patterns
+RulesPtr load( const RulesPtr& parent, const sys_string& filename, const std::string& base );
+
+//! \returns true, if filename is a .gitignore file
+bool isIgnoreFile( const sys_string& filename );
+
+//! \returns path relative to a root of size root with / as separator
+std::string relative( const sys_string& path, const size_t root );
+
+//! like utils::recurseDirParallel, but loads the .gitignore files of each directory
+//! and skips ignored files and directories
+//! \param root size of the path, to which the rules are relative, including its trailing separator
+//! \param onRepo called instead of walking nested repos and submodules, if set
+//! \param descend returns false for subdirectories, which are skipped, if set
+//! \param onListed called by the same thread after the files of each directory were passed to callback, if set
+template<class Pool>
+void recurseDirParallel( Pool& pool, const sys_string& dirname, const size_t root, RulesPtr rules,
+                         const std::function<void( const sys_string& filename )>& callback,
+                         const std::function<void( const sys_string& dirname )>& onRepo = nullptr,
+                         const std::function<bool( const sys_string& dirname )>& descend = nullptr,
+                         const std::function<void()>& onListed = nullptr ) {
+    // files with their utils::listedInode
+    std::vector<std::pair<sys_string, uint64_t>> files;
+    std::vector<sys_string> dirs;
+    const bool repo = utils::listDir( dirname, [&files]( const sys_string & filename ) {
+        files.emplace_back( filename, utils::listedInode );
+    }, [&dirs]( const sys_string & subdir ) {
+        dirs.push_back( subdir );
+    } );
+
+    // nested repos have their own index and ignore files
+    if( repo && onRepo && dirname.size() > root ) {
+        onRepo( dirname );
+        return;
+    }
+
+    // the .gitignore of a directory applies to its own entries
+    for( const auto& [filename, inode] : files ) {
+        if( isIgnoreFile( filename ) ) {
+            std::string base = relative( dirname, root );
+
+            if( !base.empty() && base.back() != '/' ) { base.push_back( '/' ); }
+
+            rules = load( rules, filename, base );
+            break;
+        }
+    }
+
+    for( const auto& [filename, inode] : files ) {
+        if( rules && rules->ignored( relative( filename, root ), false ) ) { continue; }
+
+        utils::listedInode = inode;
+        callback( filename );
+    }
+
+    if( onListed ) { onListed(); }
+
+    for( const sys_string& subdir : dirs ) {
+        if( rules && rules->ignored( relative( subdir, root ), true ) ) { continue; }
+
+        if( descend && !descend( subdir ) ) { continue; }
+
+        pool.add( [&pool, subdir, root, rules, callback, onRepo, descend, onListed] {
+            recurseDirParallel( pool, subdir, root, rules, callback, onRepo, descend, onListed );
+        } );
+    }
+}
+
+}
@@ -0,0 +1,327 @@
+#include "gitindex.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "gitobjects.hpp"
+
+namespace {
+
+//! reads big endian numbers, ok is false after reading behind end
+struct Reader {
+    const char* ptr;
+    const char* end;
+    bool ok = true;
+
+    Reader( const std::string_view& content ) : ptr( content.data() ), end( content.data() + content.size() ) {}
+
+    bool has( const size_t bytes ) {
+        if( size_t( end - ptr ) < bytes ) { ok = false; }
+
+        return ok;
+    }
+
+    uint64_t number( const size_t bytes ) {
+        uint64_t value = 0;
+
+        if( !has( bytes ) ) { return value; }
+
+        for( size_t i = 0; i < bytes; ++i ) {
+            value = ( value << 8 ) | uint8_t( *ptr++ );
+        }
+
+        return value;
+    }
+
+    uint16_t u16() { return number( 2 ); }
+    uint32_t u32() { return number( 4 ); }
+    uint64_t u64() { return number( 8 ); }
+
+    void skip( const size_t bytes ) {
+        if( has( bytes ) ) { ptr += bytes; }
+    }
+
+    //! offset encoded varint of index v4
+    uint64_t varint() {
+        if( !has( 1 ) ) { return 0; }
+
+        uint8_t c = *ptr++;
+        uint64_t value = c & 127;
+
+        while( c & 128 ) {
+            if( !has( 1 ) ) { return 0; }
+
+            c = *ptr++;
+            value = ( ( value + 1 ) << 7 ) | ( c & 127 );
+        }
+
+        return value;
+    }
+};
+
+//! \returns set bits of an ewah compressed bitmap as used by the split index
+std::vector<bool> ewah( Reader& reader ) {
+    const uint32_t bits = reader.u32();
+    const uint32_t words = reader.u32();
+    std::vector<bool> set( bits, false );
+    uint64_t pos = 0;
+
+    for( uint32_t word = 0; word < words && reader.ok; ) {
+        // running length word: running bit, 32 bit run length in words, 31 bit literal count
+        const uint64_t rlw = reader.u64();
+        ++word;
+        const uint64_t run = ( ( rlw >> 1 ) & 0xFFFFFFFF ) * 64;
+
+        if( rlw & 1 ) {
+            std::fill( set.begin() + std::min<uint64_t>( pos, bits ), set.begin() + std::min<uint64_t>( pos + run, bits ), true );
+        }
+
+        pos += run;
+
+        for( uint64_t literals = rlw >> 33; literals && word < words && reader.ok; --literals, ++word, pos += 64 ) {
+            const uint64_t literal = reader.u64();
+
+            for( uint64_t bit = 0; bit < 64 && pos + bit < bits; ++bit ) {
+                if( literal & ( uint64_t( 1 ) << bit ) ) { set[pos + bit] = true; }
+            }
+        }
+    }
+
+    // position of the last running length word
+    reader.u32();
+    return set;
+}
+
+//! parses the entries of an index and calls onEntry for each
+//! \returns reader behind the entries at the extensions
+Reader entries( const std::string_view& content, const std::function<void( gitindex::Entry& entry )>& onEntry ) {
+    Reader reader( content );
+
+    if( !reader.has( 12 ) || memcmp( reader.ptr, "DIRC", 4 ) ) {
+        reader.ok = false;
+        return reader;
+    }
+
+    reader.skip( 4 );
+    const uint32_t version = reader.u32();
+    const uint32_t count = reader.u32();
+
+    if( version < 2 || version > 4 ) { reader.ok = false; }
+
+    gitindex::Entry entry;
+
+    for( uint32_t i = 0; i < count && reader.ok; ++i ) {
+        const char* start = reader.ptr;
+        entry.ctime = reader.u32();
+        entry.ctimeNs = reader.u32();
+        entry.mtime = reader.u32();
+        entry.mtimeNs = reader.u32();
+        entry.dev = reader.u32();
+        entry.ino = reader.u32();
+        entry.mode = reader.u32();
+        entry.uid = reader.u32();
+        entry.gid = reader.u32();
+        entry.size = reader.u32();
+
+        if( !reader.has( entry.oid.size() ) ) { break; }
+
+        memcpy( entry.oid.data(), reader.ptr, entry.oid.size() );
+        reader.skip( entry.oid.size() );
+        entry.flags = reader.u16();
+        entry.extended = version >= 3 && ( entry.flags & 0x4000 ) ? reader.u16() : 0;
+
+        // v4 strips the prefix shared with the previous path
+        if( version == 4 ) {
+            const uint64_t strip = reader.varint();
+
+            if( strip > entry.path.size() ) { reader.ok = false; }
+
+            entry.path.resize( entry.path.size() - std::min<uint64_t>( strip, entry.path.size() ) );
+        } else {
+            entry.path.clear();
+        }
+
+        const char* nul = static_cast<const char*>( memchr( reader.ptr, '\0', reader.end - reader.ptr ) );
+
+        if( !reader.ok || !nul ) {
+            reader.ok = false;
+            break;
+        }
+
+        entry.path.append( reader.ptr, nul );
+        reader.ptr = nul + 1;
+
+        // v2 and v3 pad entries with 1 to 8 \0 to a multiple of 8
+        if( version < 4 ) {
+            const size_t padded = ( nul - start + 8 ) & ~size_t( 7 );
+            reader.ptr = start;
+            reader.skip( padded );
+        }
+
+        onEntry( entry );
+    }
+
+    return reader;
+}
+
+std::string hex( const char* data, const size_t size ) {
+    std::string text;
+
+    for( size_t i = 0; i < size; ++i ) {
+        text += utils::format( "%02x", uint8_t( data[i] ) );
+    }
+
+    return text;
+}
+
+}
+
+fs::path gitindex::gitDir( const fs::path& root ) {
+    const fs::path git = root / ".git";
+
+    if( !fs::is_regular_file( git ) ) { return git; }
+
+    std::ifstream file( git.native(), std::ios::binary );
+    std::string line;
+    std::getline( file, line );
+    const std::string prefix = "gitdir:";
+
+    if( line.compare( 0, prefix.size(), prefix ) ) { return git; }
+
+    line.erase( 0, prefix.size() );
+    line.erase( 0, line.find_first_not_of( " \t" ) );
+    line.erase( line.find_last_not_of( " \t\r" ) + 1 );
+
+    fs::path dir = line;
+    return dir.is_absolute() ? dir : root / dir;
+}
+
+bool gitindex::isModified( const Entry& entry, const sys_string& path ) {
+#ifndef _WIN32
+    struct stat st;
+
+    if( lstat( path.c_str(), &st ) ) { return true; }
+
+    if( uint32_t( st.st_size ) != entry.size || ( st.st_mode & S_IFMT ) != ( entry.mode & S_IFMT ) ) { return true; }
+
+#ifdef __APPLE__
+    const timespec& mtime = st.st_mtimespec;
+    const timespec& ctime = st.st_ctimespec;
+#else
+    const timespec& mtime = st.st_mtim;
+    const timespec& ctime = st.st_ctim;
+#endif
+
+    if( uint32_t( mtime.tv_sec ) == entry.mtime && uint32_t( mtime.tv_nsec ) == entry.mtimeNs &&
+            uint32_t( ctime.tv_sec ) == entry.ctime && uint32_t( ctime.tv_nsec ) == entry.ctimeNs &&
+            uint32_t( st.st_ino ) == entry.ino ) {
+        return false;
+    }
+
+#else
+    boost::system::error_code error;
+
+    if( fs::file_size( path, error ) != entry.size || error ) { return true; }
+
+#endif
+
+    // touched, but maybe not changed
+    if( !entry.isFile() || ( entry.mode >> 12 ) != 010 ) { return true; }
+
+    utils::ReadOptions options;
+    options.binary = true;
+    options.sizeHint = entry.size;
+    const utils::FileView view = utils::fromFileP( path, options );
+    const gitobjects::Oid oid = gitobjects::hashBlob( view.content );
+    return !std::equal( oid.cbegin(), oid.cend(), entry.oid.cbegin() );
+}
+
+bool gitindex::read( const fs::path& gitDir, const std::function<void( const Entry& entry )>& callback ) {
+    const utils::MappedFile index( gitDir / "index" );
+    const std::string_view& content = index.content();
+    const size_t checksum = 20;
+
+    // find the extensions behind the entries
+    Reader reader = entries( content, []( Entry& ) {} );
+
+    if( !reader.ok ) { return false; }
+
+    std::string shared;
+    std::vector<bool> deleted;
+    std::vector<bool> replaced;
+
+    while( reader.ok && size_t( reader.end - reader.ptr ) > checksum ) {
+        const std::string signature( reader.ptr, 4 );
+        reader.skip( 4 );
+        const uint32_t size = reader.u32();
+
+        if( !reader.has( size ) ) { break; }
+
+        Reader extension( std::string_view( reader.ptr, size ) );
+        reader.skip( size );
+
+        if( signature != "link" || !extension.has( checksum ) ) { continue; }
+
+        shared = hex( extension.ptr, checksum );
+        extension.skip( checksum );
+
+        if( extension.ptr != extension.end ) {
+            deleted = ewah( extension );
+            replaced = ewah( extension );
+        }
+    }
+
+    std::string last;
+    auto emit = [&callback, &last]( const Entry & entry ) {
+        // conflicts have up to 3 entries with the same path
+        if( entry.path == last ) { return; }
+
+        last = entry.path;
+        callback( entry );
+    };
+
+    if( shared.empty() || shared == std::string( 2 * checksum, '0' ) ) {
+        return entries( content, emit ).ok;
+    }
+
+    // split index: entries of the shared index, minus the deleted ones,
+    // replaced by the first entries of this index, plus the rest of them
+    const utils::MappedFile sharedIndex( gitDir / ( "sharedindex." + shared ) );
+    std::vector<Entry> merged;
+    Reader sharedReader = entries( sharedIndex.content(), [&merged]( Entry & entry ) { merged.push_back( entry ); } );
+
+    if( !sharedReader.ok ) { return false; }
+
+    size_t next = 0; // next replaced position
+    std::vector<Entry> added;
+    Reader splitReader = entries( content, [&]( Entry & entry ) {
+        while( next < replaced.size() && next < merged.size() && !replaced[next] ) { ++next; }
+
+        if( next < replaced.size() && next < merged.size() ) {
+            // replaced entries may have empty paths
+            if( entry.path.empty() ) { entry.path = merged[next].path; }
+
+            merged[next++] = entry;
+        } else {
+            added.push_back( entry );
+        }
+    } );
+
+    if( !splitReader.ok ) { return false; }
+
+    for( size_t i = 0; i < merged.size(); ++i ) {
+        if( i < deleted.size() && deleted[i] ) { continue; }
+
+        added.push_back( std::move( merged[i] ) );
+    }
+
+    std::stable_sort( added.begin(), added.end(), []( const Entry & a, const Entry & b ) { return a.path < b.path; } );
+
+    for( const Entry& entry : added ) { emit( entry ); }
+
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "utils.hpp"
+
+namespace gitindex {
+
+//! one tracked file of the index
+struct Entry {
+    uint32_t ctime = 0;   // seconds
+    uint32_t ctimeNs = 0;
+    uint32_t mtime = 0;   // seconds
+    uint32_t mtimeNs = 0;
+    uint32_t dev = 0;
+    uint32_t ino = 0;
+    uint32_t mode = 0;    // 0100644, 0100755, 0120000 for symlinks or 0160000 for submodules
+    uint32_t uid = 0;
+    uint32_t gid = 0;
+    uint32_t size = 0;    // truncated to 32 bit
+    std::array<unsigned char, 20> oid = {}; // sha1 of the blob
+    uint16_t flags = 0;
+    uint16_t extended = 0; // v3 flags like skip-worktree
+    std::string path;     // relative to the repo with / as separator
+
+    static constexpr uint16_t skipWorktree = 0x4000;
+
+    //! \returns 0 for merged entries, 1 to 3 for conflicts
+    int stage() const { return ( flags >> 12 ) & 3; }
+    //! \returns true, for regular files and symlinks
+    bool isFile() const { return ( mode >> 12 ) == 010 || ( mode >> 12 ) == 012; }
+    //! \returns true, for submodules
+    bool isGitlink() const { return ( mode >> 12 ) == 016; }
+};
+
+//! compares the cached stat data of entry with the file at path like git status,
+//! and hashes the content only, if the stat data differs, but the size doesn't
+//! \returns true, if the file differs from the index or is missing
+bool isModified( const Entry& entry, const sys_string& path );
+
+//! \returns the git dir of the repo in root, .git or the target of a .git file like in worktrees
+fs::path gitDir( const fs::path& root );
+
+//! mmaps the index of gitDir and calls callback for each entry of stage 0 or the first conflict stage
+//! \note supports versions 2 to 4 and split indexes, but only sha1 repos
+//! \returns false, if there is no index or it is corrupt
+bool read( const fs::path& gitDir, const std::function<void( const Entry& entry )>& callback );
+
+}
@@ -0,0 +1,701 @@
+#include "gitobjects.hpp"
+
+#include <algorithm>
+
+#include "boost/uuid/detail/sha1.hpp"
+
+#include "compression.hpp"
+
+namespace {
+
+uint32_t be32( const char* ptr ) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( ptr );
+    return uint32_t( bytes[0] ) << 24 | uint32_t( bytes[1] ) << 16 | uint32_t( bytes[2] ) << 8 | bytes[3];
+}
+
+uint64_t be64( const char* ptr ) {
+    return uint64_t( be32( ptr ) ) << 32 | be32( ptr + 4 );
+}
+
+//! \returns content of filename without trailing whitespace, or an empty string
+std::string readLine( const fs::path& filename ) {
+    std::string line( utils::MappedFile( filename ).content() );
+
+    while( !line.empty() && isspace( static_cast<unsigned char>( line.back() ) ) ) { line.pop_back(); }
+
+    return line;
+}
+
+//! \returns value of the first header line starting with key in a commit or tag, like "tree <hex>"
+std::string_view header( const std::string_view& content, const std::string_view& key ) {
+    for( size_t from = 0; from < content.size(); ) {
+        size_t to = content.find( '\n', from );
+
+        if( to == std::string_view::npos ) { to = content.size(); }
+
+        const std::string_view line = content.substr( from, to - from );
+
+        // headers end at the first empty line
+        if( line.empty() ) { break; }
+
+        if( !line.compare( 0, key.size(), key ) ) { return line.substr( key.size() ); }
+
+        from = to + 1;
+    }
+
+    return std::string_view();
+}
+
+//! parses the type and size of a packed object, advances ptr behind the header
+bool packedHeader( const char*& ptr, const char* end, int& type, uint64_t& size ) {
+    if( ptr == end ) { return false; }
+
+    uint8_t c = *ptr++;
+    type = ( c >> 4 ) & 7;
+    size = c & 15;
+
+    for( int shift = 4; c & 128; shift += 7 ) {
+        if( ptr == end || shift > 57 ) { return false; }
+
+        c = *ptr++;
+        size |= uint64_t( c & 127 ) << shift;
+    }
+
+    return true;
+}
+
+//! applies a git delta to base
+//! \returns false, if delta is corrupt or does not fit to base
+bool applyDelta( const std::string_view& base, const std::string_view& delta, utils::Buffer& out ) {
+    const char* ptr = delta.data();
+    const char* end = ptr + delta.size();
+    bool ok = true;
+
+    auto next = [&ptr, end, &ok]() -> uint8_t {
+        if( ptr == end ) {
+            ok = false;
+            return 0;
+        }
+
+        return *ptr++;
+    };
+
+    // little endian sizes of base and result
+    auto varint = [&next, &ok]() {
+        uint64_t value = 0;
+        uint8_t c = 0;
+
+        for( int shift = 0; ok && shift < 64; shift += 7 ) {
+            c = next();
+            value |= uint64_t( c & 127 ) << shift;
+
+            if( !( c & 128 ) ) { break; }
+        }
+
+        return value;
+    };
+
+    const uint64_t baseSize = varint();
+    const uint64_t size = varint();
+
+    if( !ok || baseSize != base.size() ) { return false; }
+
+    char* dst = out.grow( size );
+    uint64_t pos = 0;
+
+    if( !dst ) { return false; }
+
+    while( ok && ptr != end ) {
+        const uint8_t c = next();
+
+        if( c & 128 ) {
+            // copy from base, with the bytes of offset and size flagged in c
+            uint64_t offset = 0;
+            uint64_t bytes = 0;
+
+            for( int i = 0; i < 4; ++i ) {
+                if( c & ( 1 << i ) ) { offset |= uint64_t( next() ) << ( 8 * i ); }
+            }
+
+            for( int i = 0; i < 3; ++i ) {
+                if( c & ( 16 << i ) ) { bytes |= uint64_t( next() ) << ( 8 * i ); }
+            }
+
+            if( !bytes ) { bytes = 0x10000; }
+
+            if( !ok || offset + bytes > base.size() || pos + bytes > size ) { return false; }
+
+            memcpy( dst + pos, base.data() + offset, bytes );
+            pos += bytes;
+        } else if( c ) {
+            // insert the next c bytes of delta
+            if( size_t( end - ptr ) < c || pos + c > size ) { return false; }
+
+            memcpy( dst + pos, ptr, c );
+            ptr += c;
+            pos += c;
+        } else {
+            return false;
+        }
+    }
+
+    return ok && pos == size;
+}
+
+//! inflates a zlib stream of known size from the start of content into out
+bool inflate( const std::string_view& content, const uint64_t size, utils::Buffer& out ) {
+    if( !size ) {
+        return out.grow( 0 ) != nullptr;
+    }
+
+    return compression::decompress( compression::Format::Zlib, content, out, size );
+}
+
+}
+
+bool gitobjects::parseOid( const std::string_view& hex, Oid& oid ) {
+    if( hex.size() != 2 * oid.size() ) { return false; }
+
+    for( size_t i = 0; i < hex.size(); ++i ) {
+        const char c = hex[i];
+        int value = 0;
+
+        if( c >= '0' && c <= '9' ) {
+            value = c - '0';
+        } else if( c >= 'a' && c <= 'f' ) {
+            value = c - 'a' + 10;
+        } else if( c >= 'A' && c <= 'F' ) {
+            value = c - 'A' + 10;
+        } else {
+            return false;
+        }
+
+        if( i % 2 ) {
+            oid[i / 2] |= value;
+        } else {
+            oid[i / 2] = value << 4;
+        }
+    }
+
+    return true;
+}
+
+std::string gitobjects::toHex( const Oid& oid ) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex( 2 * oid.size(), '0' );
+
+    for( size_t i = 0; i < oid.size(); ++i ) {
+        hex[2 * i] = digits[oid[i] >> 4];
+        hex[2 * i + 1] = digits[oid[i] & 15];
+    }
+
+    return hex;
+}
+
+gitobjects::Oid gitobjects::hashBlob( const std::string_view& content ) {
+    const std::string header = "blob " + std::to_string( content.size() );
+    boost::uuids::detail::sha1 sha1;
+    sha1.process_bytes( header.c_str(), header.size() + 1 );
+    sha1.process_bytes( content.data(), content.size() );
+
+    boost::uuids::detail::sha1::digest_type digest;
+    sha1.get_digest( digest );
+    Oid oid;
+
+    // older boost versions return 5 big endian words instead of 20 bytes
+    if constexpr( sizeof( digest[0] ) == 4 ) {
+        for( size_t i = 0; i < oid.size(); ++i ) {
+            oid[i] = static_cast<unsigned char>( digest[i / 4] >> ( 24 - 8 * ( i % 4 ) ) );
+        }
+    } else {
+        std::copy( std::begin( digest ), std::end( digest ), oid.begin() );
+    }
+
+    return oid;
+}
+
+//! mmap'ed pack and its index in version 2
+struct gitobjects::Repo::Pack {
+    utils::MappedFile idx;
+    utils::MappedFile data;
+    uint32_t count = 0;
+    const char* fanout = nullptr;
+    const char* oids = nullptr;
+    const char* offsets = nullptr;
+    const char* largeOffsets = nullptr;
+
+    Pack( const fs::path& idxFile, const fs::path& packFile ) : idx( idxFile ), data( packFile ) {
+        const std::string_view& content = idx.content();
+
+        if( content.size() < 8 + 256 * 4 || memcmp( content.data(), "\377tOc", 4 ) || be32( content.data() + 4 ) != 2 ) { return; }
+
+        if( data.content().size() < 12 || memcmp( data.content().data(), "PACK", 4 ) ) { return; }
+
+        fanout = content.data() + 8;
+        const uint32_t entries = be32( fanout + 255 * 4 );
+
+        // oids, crc32s and offsets, followed by 64 bit offsets and 2 checksums
+        if( content.size() < 8 + 256 * 4 + uint64_t( entries ) * 28 + 40 ) { return; }
+
+        oids = fanout + 256 * 4;
+        offsets = oids + uint64_t( entries ) * 24;
+        largeOffsets = offsets + uint64_t( entries ) * 4;
+        count = entries;
+    }
+
+    const unsigned char* oid( const uint32_t pos ) const {
+        return reinterpret_cast<const unsigned char*>( oids ) + 20 * uint64_t( pos );
+    }
+
+    //! \returns range of the entries starting with byte first
+    std::pair<uint32_t, uint32_t> range( const unsigned char first ) const {
+        if( !count ) { return { 0, 0 }; }
+
+        return { first ? be32( fanout + 4 * ( first - 1 ) ) : 0, be32( fanout + 4 * first ) };
+    }
+
+    //! \returns offset of the object in the pack, or 0, if it's not in this pack
+    uint64_t find( const Oid& id ) const {
+        auto [low, high] = range( id[0] );
+
+        while( low < high ) {
+            const uint32_t mid = low + ( high - low ) / 2;
+            const int cmp = memcmp( oid( mid ), id.data(), id.size() );
+
+            if( !cmp ) {
+                const uint32_t offset = be32( offsets + 4 * uint64_t( mid ) );
+
+                if( !( offset & 0x80000000 ) ) { return offset; }
+
+                const char* large = largeOffsets + 8 * uint64_t( offset & 0x7FFFFFFF );
+                return large + 8 <= idx.content().data() + idx.content().size() ? be64( large ) : 0;
+            }
+
+            if( cmp < 0 ) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        return 0;
+    }
+};
+
+gitobjects::Repo::Repo( const fs::path& gitDir ) : gitDir( gitDir ), commonDir( gitDir ) {
+    // worktrees share refs and objects with the main repo
+    const std::string common = readLine( gitDir / "commondir" );
+
+    if( !common.empty() ) {
+        fs::path dir = common;
+        commonDir = dir.is_absolute() ? dir : gitDir / dir;
+    }
+
+    objectDirs.push_back( commonDir / "objects" );
+
+    // objects borrowed from other repos, one directory per line
+    const std::string alternates( utils::MappedFile( commonDir / "objects" / "info" / "alternates" ).content() );
+    size_t from = 0;
+
+    while( from < alternates.size() ) {
+        size_t to = alternates.find( '\n', from );
+
+        if( to == std::string::npos ) { to = alternates.size(); }
+
+        const std::string line = alternates.substr( from, to - from );
+        from = to + 1;
+
+        if( line.empty() || line.front() == '#' ) { continue; }
+
+        fs::path dir = line;
+        objectDirs.push_back( dir.is_absolute() ? dir : commonDir / "objects" / dir );
+    }
+
+    boost::system::error_code error;
+
+    for( const fs::path& objects : objectDirs ) {
+        for( fs::directory_iterator it( objects / "pack", error ), end; !error && it != end; it.increment( error ) ) {
+            const fs::path& idx = it->path();
+
+            if( idx.extension() != ".idx" ) { continue; }
+
+            auto pack = std::make_unique<Pack>( idx, fs::path( idx ).replace_extension( ".pack" ) );
+
+            if( pack->count ) { packs.push_back( std::move( pack ) ); }
+        }
+    }
+}
+
+gitobjects::Repo::~Repo() = default;
+
+bool gitobjects::Repo::readRef( const std::string& name, Oid& oid, const int depth ) const {
+    // symbolic refs like HEAD may point to symbolic refs again
+    if( depth > 5 ) { return false; }
+
+    std::string content = readLine( gitDir / name );
+
+    if( content.empty() && commonDir != gitDir ) { content = readLine( commonDir / name ); }
+
+    if( !content.compare( 0, 5, "ref: " ) ) { return readRef( content.substr( 5 ), oid, depth + 1 ); }
+
+    if( parseOid( content, oid ) ) { return true; }
+
+    // packed-refs has lines like "<hex> refs/heads/main"
+    const utils::MappedFile packed( commonDir / "packed-refs" );
+    const std::string_view& refs = packed.content();
+
+    for( size_t from = 0; from < refs.size(); ) {
+        size_t to = refs.find( '\n', from );
+
+        if( to == std::string_view::npos ) { to = refs.size(); }
+
+        std::string_view line = refs.substr( from, to - from );
+        from = to + 1;
+
+        if( !line.empty() && line.back() == '\r' ) { line.remove_suffix( 1 ); }
+
+        if( line.size() == 2 * oid.size() + 1 + name.size() && line[2 * oid.size()] == ' ' && line.substr( 2 * oid.size() + 1 ) == name ) {
+            return parseOid( line.substr( 0, 2 * oid.size() ), oid );
+        }
+    }
+
+    return false;
+}
+
+bool gitobjects::Repo::findPrefix( const std::string& prefix, Oid& oid ) const {
+    size_t found = 0;
+    Oid candidate;
+
+    // packed objects within the range of the first byte
+    for( const auto& pack : packs ) {
+        Oid first = {};
+
+        if( !parseOid( prefix.substr( 0, 2 ) + std::string( 2 * oid.size() - 2, '0' ), first ) ) { return false; }
+
+        auto [low, high] = pack->range( first[0] );
+
+        for( uint32_t pos = low; pos < high; ++pos ) {
+            std::copy( pack->oid( pos ), pack->oid( pos ) + candidate.size(), candidate.begin() );
+
+            if( toHex( candidate ).compare( 0, prefix.size(), prefix ) ) { continue; }
+
+            // the same object may be in several packs
+            if( found && candidate == oid ) { continue; }
+
+            oid = candidate;
+            ++found;
+        }
+    }
+
+    // loose objects in objects/xx/
+    for( const fs::path& objects : objectDirs ) {
+        boost::system::error_code error;
+
+        for( fs::directory_iterator it( objects / prefix.substr( 0, 2 ), error ), end; !error && it != end; it.increment( error ) ) {
+            const std::string hex = prefix.substr( 0, 2 ) + it->path().filename().string();
+
+            if( hex.compare( 0, prefix.size(), prefix ) || !parseOid( hex, candidate ) ) { continue; }
+
+            if( found && candidate == oid ) { continue; }
+
+            oid = candidate;
+            ++found;
+        }
+    }
+
+    return found == 1;
+}
+
+bool gitobjects::Repo::resolve( const std::string& rev, Oid& oid ) const {
+    const size_t suffix = std::min( rev.find_first_of( "~^" ), rev.size() );
+    const std::string name = rev.substr( 0, suffix );
+
+    if( name.empty() ) { return false; }
+
+    // same order as git rev-parse
+    const std::vector<std::string> refs = {
+        name, "refs/" + name, "refs/tags/" + name, "refs/heads/" + name, "refs/remotes/" + name, "refs/remotes/" + name + "/HEAD"
+    };
+
+    bool found = name.find( ".." ) == std::string::npos &&
+                 std::any_of( refs.cbegin(), refs.cend(), [&oid, this]( const std::string & ref ) { return readRef( ref, oid ); } );
+
+    if( !found ) { found = parseOid( name, oid ); }
+
+    if( !found && name.size() >= 4 && name.size() < 2 * oid.size() && name.find_first_not_of( "0123456789abcdef" ) == std::string::npos ) {
+        found = findPrefix( name, oid );
+    }
+
+    // ~N follows N first parents, ^N takes the Nth parent, both default to 1
+    for( size_t pos = suffix; found && pos < rev.size(); ) {
+        const char op = rev[pos++];
+        const size_t digits = std::min( rev.find_first_not_of( "0123456789", pos ), rev.size() );
+        const size_t n = digits > pos ? std::stoul( rev.substr( pos, digits - pos ) ) : 1;
+        pos = digits;
+
+        if( op == '~' ) {
+            for( size_t i = 0; found && i < n; ++i ) {
+                const std::vector<Oid> list = parents( oid );
+                found = !list.empty();
+
+                if( found ) { oid = list.front(); }
+            }
+        } else if( op == '^' && n ) {
+            const std::vector<Oid> list = parents( oid );
+            found = n <= list.size();
+
+            if( found ) { oid = list[n - 1]; }
+        } else if( op != '^' ) {
+            found = false;
+        }
+    }
+
+    return found;
+}
+
+gitobjects::Type gitobjects::Repo::readLoose( const Oid& oid, utils::Buffer& out ) const {
+    const std::string hex = toHex( oid );
+    utils::ReadOptions options;
+    options.binary = true;
+
+    for( const fs::path& objects : objectDirs ) {
+        const fs::path filename = objects / hex.substr( 0, 2 ) / hex.substr( 2 );
+        utils::FileView view = utils::fromFileP( filename.native(), options );
+
+        if( !view.size ) { continue; }
+
+        if( !compression::decompress( compression::Format::Zlib, view.content, out ) ) { return Type::None; }
+
+        // header like "blob 1234\0"
+        const std::string_view content( out.ptr, out.size );
+        const size_t space = content.find( ' ' );
+        const size_t nul = content.find( '\0' );
+
+        if( space == std::string_view::npos || nul == std::string_view::npos || space > nul ) { return Type::None; }
+
+        const std::string_view name = content.substr( 0, space );
+        const size_t size = out.size - nul - 1;
+        const Type type = name == "commit" ? Type::Commit : name == "tree" ? Type::Tree :
+                          name == "blob" ? Type::Blob : name == "tag" ? Type::Tag : Type::None;
+
+        if( std::to_string( size ) != content.substr( space + 1, nul - space - 1 ) ) { return Type::None; }
+
+        memmove( out.ptr, out.ptr + nul + 1, size );
+        out.grow( size );
+        return type;
+    }
+
+    return Type::None;
+}
+
+gitobjects::Type gitobjects::Repo::read( const Oid& oid, utils::Buffer& out ) const {
+    const Pack* pack = nullptr;
+    uint64_t offset = 0;
+
+    for( const auto& candidate : packs ) {
+        offset = candidate->find( oid );
+
+        if( offset ) {
+            pack = candidate.get();
+            break;
+        }
+    }
+
+    if( !pack ) { return readLoose( oid, out ); }
+
+    // follow the delta chain down to its base object
+    struct Delta {
+        const char* data;
+        const char* end;
+        uint64_t size;
+    };
+    std::vector<Delta> deltas;
+    int type = 0;
+
+    for( ;; ) {
+        const std::string_view& content = pack->data.content();
+        const char* end = content.data() + content.size();
+
+        if( offset >= content.size() || deltas.size() > 10000 ) { return Type::None; }
+
+        const char* ptr = content.data() + offset;
+        uint64_t size = 0;
+
+        if( !packedHeader( ptr, end, type, size ) ) { return Type::None; }
+
+        if( type >= 1 && type <= 4 ) {
+            if( !inflate( std::string_view( ptr, end - ptr ), size, out ) ) { return Type::None; }
+
+            break;
+        }
+
+        if( type == 6 ) {
+            // offset delta, base is at a negative offset in the same pack
+            if( ptr == end ) { return Type::None; }
+
+            uint8_t c = *ptr++;
+            uint64_t distance = c & 127;
+
+            while( c & 128 ) {
+                if( ptr == end ) { return Type::None; }
+
+                c = *ptr++;
+                distance = ( ( distance + 1 ) << 7 ) | ( c & 127 );
+            }
+
+            if( distance > offset ) { return Type::None; }
+
+            deltas.push_back( { ptr, end, size } );
+            offset -= distance;
+        } else if( type == 7 ) {
+            // ref delta, base is any object
+            Oid base;
+
+            if( size_t( end - ptr ) < base.size() ) { return Type::None; }
+
+            std::copy( ptr, ptr + base.size(), base.begin() );
+            deltas.push_back( { ptr + base.size(), end, size } );
+
+            pack = nullptr;
+
+            for( const auto& candidate : packs ) {
+                offset = candidate->find( base );
+
+                if( offset ) {
+                    pack = candidate.get();
+                    break;
+                }
+            }
+
+            if( !pack ) {
+                type = int( readLoose( base, out ) );
+
+                if( !type ) { return Type::None; }
+
+                break;
+            }
+        } else {
+            return Type::None;
+        }
+    }
+
+    // apply the deltas from the base up, alternating between out and spare
+    static thread_local utils::Buffer delta;
+    static thread_local utils::Buffer spare;
+    utils::Buffer* current = &out;
+    utils::Buffer* next = &spare;
+
+    for( auto it = deltas.crbegin(); it != deltas.crend(); ++it ) {
+        if( !inflate( std::string_view( it->data, it->end - it->data ), it->size, delta ) ) { return Type::None; }
+
+        if( !applyDelta( std::string_view( current->ptr, current->size ), std::string_view( delta.ptr, delta.size ), *next ) ) {
+            return Type::None;
+        }
+
+        std::swap( current, next );
+    }
+
+    if( current != &out ) {
+        if( !out.grow( current->size ) ) { return Type::None; }
+
+        memcpy( out.ptr, current->ptr, current->size );
+    }
+
+    return Type( type );
+}
+
+std::vector<gitobjects::Oid> gitobjects::Repo::parents( const Oid& oid ) const {
+    static thread_local utils::Buffer buffer;
+    std::vector<Oid> list;
+    Oid commit = oid;
+
+    for( Type type = read( commit, buffer ); type == Type::Tag; type = read( commit, buffer ) ) {
+        if( !parseOid( header( std::string_view( buffer.ptr, buffer.size ), "object " ), commit ) ) { return list; }
+    }
+
+    // parent lines follow the tree line
+    const std::string_view content( buffer.ptr, buffer.size );
+
+    for( size_t from = 0; from < content.size(); ) {
+        size_t to = content.find( '\n', from );
+
+        if( to == std::string_view::npos || to == from ) { break; }
+
+        Oid parent;
+
+        if( !content.compare( from, 7, "parent " ) && parseOid( content.substr( from + 7, to - from - 7 ), parent ) ) {
+            list.push_back( parent );
+        }
+
+        from = to + 1;
+    }
+
+    return list;
+}
+
+bool gitobjects::Repo::peelToTree( Oid oid, Oid& tree ) const {
+    static thread_local utils::Buffer buffer;
+
+    for( int depth = 0; depth < 10; ++depth ) {
+        const Type type = read( oid, buffer );
+        const std::string_view content( buffer.ptr, buffer.size );
+
+        switch( type ) {
+            case Type::Tree:
+                tree = oid;
+                return true;
+
+            case Type::Commit:
+                return parseOid( header( content, "tree " ), tree );
+
+            case Type::Tag:
+                if( !parseOid( header( content, "object " ), oid ) ) { return false; }
+
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+bool gitobjects::Repo::walkTree( const Oid& oid, const std::function<void( const std::string& path, const Oid& entry, const uint32_t mode )>& callback ) const {
+    Oid tree;
+    return peelToTree( oid, tree ) && walkTree( tree, "", callback );
+}
+
+bool gitobjects::Repo::walkTree( const Oid& tree, const std::string& prefix,
+                                 const std::function<void( const std::string& path, const Oid& entry, const uint32_t mode )>& callback ) const {
+    static thread_local utils::Buffer buffer;
+
+    if( read( tree, buffer ) != Type::Tree ) { return false; }
+
+    // copy, as subtrees are read into the same buffer
+    const std::string content( buffer.ptr, buffer.size );
+
+    // entries like "100644 name\0<20 bytes oid>"
+    for( size_t pos = 0; pos < content.size(); ) {
+        const size_t space = content.find( ' ', pos );
+        const size_t nul = content.find( '\0', pos );
+        Oid entry;
+
+        if( space == std::string::npos || nul == std::string::npos || space == pos || space > nul || nul + 1 + entry.size() > content.size() ) {
+            return false;
+        }
+
+        const uint32_t mode = std::stoul( content.substr( pos, space - pos ), nullptr, 8 );
+        const std::string path = prefix + content.substr( space + 1, nul - space - 1 );
+        std::copy( content.cbegin() + nul + 1, content.cbegin() + nul + 1 + entry.size(), entry.begin() );
+        pos = nul + 1 + entry.size();
+
+        if( ( mode >> 12 ) == 004 ) {
+            if( !walkTree( entry, path + "/", callback ) ) { return false; }
+        } else {
+            callback( path, entry, mode );
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace gitobjects {
+
+using Oid = std::array<unsigned char, 20>;
+
+enum class Type {
+    None = 0, // missing or corrupt
+    Commit = 1,
+    Tree = 2,
+    Blob = 3,
+    Tag = 4
+};
+
+//! \returns false, if hex is not a full object id of 40 hex digits
+bool parseOid( const std::string_view& hex, Oid& oid );
+
+//! \returns oid as 40 hex digits
+std::string toHex( const Oid& oid );
+
+//! \returns object id of a blob with content, like git hash-object
+Oid hashBlob( const std::string_view& content );
+
+//! read only access to the loose and packed objects of a repo
+//! \note thread safe, packs are mmap'ed once and shared by all workers
+class Repo {
+    public:
+        explicit Repo( const fs::path& gitDir );
+        ~Repo();
+
+        //! resolves HEAD, branches, tags, remote branches and full or abbreviated object ids,
+        //! followed by ~N and ^N for ancestors like in git
+        //! \returns false, if rev is unknown or ambiguous
+        bool resolve( const std::string& rev, Oid& oid ) const;
+
+        //! inflates object oid into out, resolving the delta chains of packed objects
+        //! \returns type of the object, or Type::None if it is missing or corrupt
+        Type read( const Oid& oid, utils::Buffer& out ) const;
+
+        //! calls callback for each entry of the tree of a commit, tag or tree oid, but not for subtrees
+        //! \param path of the entry relative to the repo
+        //! \param mode like in the index, 0100644, 0100755, 0120000 or 0160000
+        //! \returns false, if an object is missing or corrupt
+        bool walkTree( const Oid& oid, const std::function<void( const std::string& path, const Oid& entry, const uint32_t mode )>& callback ) const;
+
+    private:
+        struct Pack;
+
+        fs::path gitDir;
+        fs::path commonDir; // with refs and objects, differs from gitDir in worktrees
+        std::vector<fs::path> objectDirs; // objects and its alternates
+        std::vector<std::unique_ptr<Pack>> packs;
+
+        //! \returns object id of the ref like refs/heads/main, following symbolic refs
+        bool readRef( const std::string& name, Oid& oid, const int depth = 0 ) const;
+        //! \returns object id starting with the hex prefix, false if none or ambiguous
+        bool findPrefix( const std::string& prefix, Oid& oid ) const;
+        //! \returns type of a loose object inflated into out
+        Type readLoose( const Oid& oid, utils::Buffer& out ) const;
+        //! \returns parents of commit oid
+        std::vector<Oid> parents( const Oid& oid ) const;
+        //! \returns tree oid of a commit or a tag pointing at one
+        bool peelToTree( Oid oid, Oid& tree ) const;
+        bool walkTree( const Oid& tree, const std::string& prefix,
+                       const std::function<void( const std::string& path, const Oid& entry, const uint32_t mode )>& callback ) const;
+};
+
+}
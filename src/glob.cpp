@@ -0,0 +1,156 @@
+#include "glob.hpp"
+
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+//! matches c against the POSIX class name like "alpha"
+bool matchClass( const std::string_view& name, const unsigned char c ) {
+    if( name == "alnum" ) { return isalnum( c ); }
+
+    if( name == "alpha" ) { return isalpha( c ); }
+
+    if( name == "blank" ) { return c == ' ' || c == '\t'; }
+
+    if( name == "digit" ) { return isdigit( c ); }
+
+    if( name == "lower" ) { return islower( c ); }
+
+    if( name == "punct" ) { return ispunct( c ); }
+
+    if( name == "space" ) { return isspace( c ); }
+
+    if( name == "upper" ) { return isupper( c ); }
+
+    if( name == "xdigit" ) { return isxdigit( c ); }
+
+    return false;
+}
+
+//! matches c against the bracket expression starting behind [ at pos
+//! \returns false, if c doesn't match or the expression is not terminated, sets pos behind ]
+bool matchBracket( const std::string_view& pattern, size_t& pos, const unsigned char c ) {
+    bool negated = false;
+
+    if( pos < pattern.size() && ( pattern[pos] == '!' || pattern[pos] == '^' ) ) {
+        negated = true;
+        ++pos;
+    }
+
+    bool matched = false;
+
+    // ] as first char is literal
+    for( bool first = true; pos < pattern.size(); first = false ) {
+        unsigned char from = pattern[pos];
+
+        if( from == ']' && !first ) {
+            ++pos;
+            return matched != negated;
+        }
+
+        // [:class:]
+        if( from == '[' && pos + 1 < pattern.size() && pattern[pos + 1] == ':' ) {
+            size_t end = pattern.find( ":]", pos + 2 );
+
+            if( end != std::string_view::npos ) {
+                matched |= matchClass( pattern.substr( pos + 2, end - pos - 2 ), c );
+                pos = end + 2;
+                continue;
+            }
+        }
+
+        if( from == '\\' && pos + 1 < pattern.size() ) { from = pattern[++pos]; }
+
+        ++pos;
+        unsigned char to = from;
+
+        // range like a-z, but not a- at the end
+        if( pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']' ) {
+            to = pattern[pos + 1];
+            pos += 2;
+
+            if( to == '\\' && pos < pattern.size() ) { to = pattern[pos++]; }
+        }
+
+        matched |= from <= c && c <= to;
+    }
+
+    return false;
+}
+
+bool matchFrom( const std::string_view& pattern, size_t p, const std::string_view& text, size_t t ) {
+    while( p < pattern.size() ) {
+        const char c = pattern[p];
+
+        if( c == '*' ) {
+            size_t stars = p;
+
+            while( stars < pattern.size() && pattern[stars] == '*' ) { ++stars; }
+
+            const bool leading = p == 0 || pattern[p - 1] == '/';
+            const bool trailing = stars == pattern.size() || pattern[stars] == '/';
+
+            // ** as whole component matches zero or more directories
+            if( stars - p >= 2 && leading && trailing ) {
+                if( stars == pattern.size() ) { return true; }
+
+                for( size_t from = t; ; ++from ) {
+                    if( matchFrom( pattern, stars + 1, text, from ) ) { return true; }
+
+                    from = text.find( '/', from );
+
+                    if( from == std::string_view::npos ) { return false; }
+                }
+            }
+
+            // * matches within a directory only
+            for( size_t from = t; ; ++from ) {
+                if( matchFrom( pattern, stars, text, from ) ) { return true; }
+
+                if( from == text.size() || text[from] == '/' ) { return false; }
+            }
+        }
+
+        if( t == text.size() ) { return false; }
+
+        if( c == '?' ) {
+            if( text[t] == '/' ) { return false; }
+
+            ++p;
+            ++t;
+            continue;
+        }
+
+        if( c == '[' ) {
+            size_t pos = p + 1;
+
+            if( text[t] == '/' || !matchBracket( pattern, pos, text[t] ) ) { return false; }
+
+            p = pos;
+            ++t;
+            continue;
+        }
+
+        char literal = c;
+
+        if( c == '\\' && p + 1 < pattern.size() ) { literal = pattern[++p]; }
+
+        if( text[t] != literal ) { return false; }
+
+        ++p;
+        ++t;
+    }
+
+    return t == text.size();
+}
+
+}
+
+bool glob::match( const std::string_view& pattern, const std::string_view& text ) {
+    return matchFrom( pattern, 0, text, 0 );
+}
+
+bool glob::hasWildcards( const std::string_view& pattern ) {
+    return pattern.find_first_of( "*?[\\" ) != std::string_view::npos;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string_view>
+
+namespace glob {
+
+//! matches text against a glob pattern like git's wildmatch with WM_PATHNAME
+//! \note * and ? don't match /, ** matches across directories if it's a whole path component,
+//! classes like [a-z], [!0-9] and [[:alpha:]] are supported, \ escapes the next char
+bool match( const std::string_view& pattern, const std::string_view& text );
+
+//! \returns true, if pattern has chars with a special meaning in globs
+bool hasWildcards( const std::string_view& pattern );
+
+}
@@ -0,0 +1,16 @@
+#include "pipeline.hpp"
+
+void pipeline::Limit::acquire() {
+    std::unique_lock<std::mutex> lock( m );
+    released.wait( lock, [this] { return available > 0; } );
+    available--;
+}
+
+void pipeline::Limit::release() {
+    {
+        std::unique_lock<std::mutex> lock( m );
+        available++;
+    }
+
+    released.notify_one();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pipeline {
+
+//! counting semaphore between two stages, the first one waits in acquire, while the second one has enough to do
+class Limit {
+    public:
+        explicit Limit( const size_t count ) : available( count ) {}
+
+        void acquire();
+        void release();
+
+    private:
+        std::mutex m;
+        std::condition_variable released;
+        size_t available;
+};
+
+//! up to count T, which one stage fills and hands to the next one, which releases them for reuse
+//! \note created on demand, so a pipeline with little to do uses only a few
+template<class T>
+class Slots {
+    public:
+        explicit Slots( const size_t count ) : limit( count ) {}
+
+        //! \returns a released or new slot, waits for a released one, if count slots are in use
+        T* acquire() {
+            limit.acquire();
+            std::unique_lock<std::mutex> lock( m );
+
+            if( spare.empty() ) {
+                all.emplace_back( new T() );
+                return all.back().get();
+            }
+
+            T* slot = spare.back();
+            spare.pop_back();
+            return slot;
+        }
+
+        void release( T* slot ) {
+            // all under the lock, so acquire finds the slot and drain returns only after the last release is done
+            std::unique_lock<std::mutex> lock( m );
+            spare.push_back( slot );
+            limit.release();
+
+            if( spare.size() == all.size() ) { drained.notify_all(); }
+        }
+
+        //! waits, until all slots are released
+        void drain() {
+            std::unique_lock<std::mutex> lock( m );
+            drained.wait( lock, [this] { return spare.size() == all.size(); } );
+        }
+
+    private:
+        Limit limit;
+        std::mutex m;
+        std::condition_variable drained;
+        std::vector<T*> spare;
+        std::vector<std::unique_ptr<T>> all;
+};
+
+}
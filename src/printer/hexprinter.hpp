@@ -0,0 +1,149 @@
+#pragma once
+
+#include "printer.hpp"
+
+//! prints matches in binaries as byte offsets with a hexdump of the surrounding rows
+struct HexPrinter : public Printer {
+    using Print = std::function<void()>;
+    std::vector<Print> prints;
+    virtual void collectPrints( const sys_string& path, const std::vector<search::Match>& matches, const std::string_view& content ) override;
+    virtual void printPrints() override;
+    HexPrinter( const SearchOptions& opts ) : Printer( opts ) {
+        // don't pipe colors
+        cred   = opts.colorized ? Color::Red   : Color::Neutral;
+        cblue  = opts.colorized ? Color::Blue  : Color::Neutral;
+        cgreen = opts.colorized ? Color::Green : Color::Neutral;
+        cgray  = opts.colorized ? Color::Gray  : Color::Neutral;
+    }
+    virtual ~HexPrinter() override {}
+
+    //! bytes per row
+    static constexpr size_t width = 16;
+    //! rows printed before and after a match
+    static constexpr size_t context = 1;
+
+    //! collects text in color, merged with the text before, if it has the same color
+    inline void add( const Color color, const std::string& text ) {
+        if( color != pendingColor ) { flush(); }
+
+        pendingColor = color;
+        pending += text;
+    }
+
+    inline void flush() {
+        if( !pending.empty() ) { prints.emplace_back( utils::printFunc( pendingColor, pending ) ); }
+
+        pending.clear();
+    }
+
+    //! collects rows from offset from to to, bytes in marked are printed in red
+    void collectRows( const std::string& filename, const std::string_view& content,
+                      const size_t from, const size_t to, const std::vector<bool>& marked );
+
+    Color cred;
+    Color cblue;
+    Color cgreen;
+    Color cgray;
+    Color pendingColor = Color::Neutral;
+    std::string pending;
+};
+
+void HexPrinter::collectRows( const std::string& filename, const std::string_view& content,
+                              const size_t from, const size_t to, const std::vector<bool>& marked ) {
+    for( size_t row = from; row < to; row += width ) {
+        // offset in blue, piped with filename for grep
+        if( opts.piped ) {
+            add( Color::Neutral, filename + ":" );
+        }
+
+        add( cblue, utils::format( "%08zx  ", row ) );
+
+        // bytes in hex, matches in red
+        for( size_t i = row; i < row + width; ++i ) {
+            if( i < content.size() ) {
+                add( marked[i - from] ? cred : Color::Neutral, utils::format( "%02x", static_cast<unsigned char>( content[i] ) ) );
+                add( Color::Neutral, " " );
+            } else {
+                add( Color::Neutral, "   " );
+            }
+
+            if( i - row == width / 2 - 1 ) { add( Color::Neutral, " " ); }
+        }
+
+        // printable chars in gray
+        std::string ascii;
+
+        for( size_t i = row; i < std::min( row + width, content.size() ); ++i ) {
+            const unsigned char c = content[i];
+            ascii.push_back( c >= 0x20 && c < 0x7F ? c : '.' );
+        }
+
+        add( cgray, " |" + ascii + "|" );
+        add( Color::Neutral, "\n" );
+    }
+}
+
+void HexPrinter::collectPrints( const sys_string& path, const std::vector<search::Match>& matches, const std::string_view& content ) {
+    prints.clear();
+    pending.clear();
+
+    const std::string filename = fromSysString( opts.prefix + path );
+
+    // print file path, paths within a revision are no files
+    if( !opts.piped ) {
+        add( cgreen, ( opts.rev.empty() ? "file://" : "" ) + filename + "\n" );
+    }
+
+    std::vector<search::Match>::const_iterator match = matches.cbegin();
+    std::vector<search::Match>::const_iterator end = matches.cend();
+    size_t printed = 0; // end of the last printed row
+
+    while( match != end ) {
+        // first row with context, but not printed twice
+        size_t offset = match->first - content.cbegin();
+        size_t from = offset / width * width;
+        from = std::max( from > context * width ? from - context * width : 0, printed );
+
+        // separate groups of rows
+        if( printed && from > printed && !opts.piped ) {
+            add( cgray, "--\n" );
+        }
+
+        // extend group with all matches, whose context overlaps
+        size_t to = from;
+        std::vector<search::Match>::const_iterator last = match;
+
+        for( ; last != end; ++last ) {
+            size_t first = ( last->first - content.cbegin() ) / width * width;
+
+            if( last != match && first > to + context * width ) { break; }
+
+            size_t stop = ( last->second - content.cbegin() + width - 1 ) / width * width + context * width;
+            to = std::max( to, std::min( stop, ( content.size() + width - 1 ) / width * width ) );
+        }
+
+        // empty regex matches still get their row
+        to = std::max( to, from + width );
+
+        std::vector<bool> marked( to - from, false );
+
+        for( ; match != last; ++match ) {
+            for( search::Iter i = match->first; i != match->second; ++i ) {
+                marked[i - content.cbegin() - from] = true;
+            }
+        }
+
+        collectRows( filename, content, from, to, marked );
+        printed = to;
+    }
+
+    if( !opts.piped ) {
+        add( Color::Neutral, "\n" );
+    }
+
+    flush();
+}
+
+void HexPrinter::printPrints() {
+    for( const std::function<void()>& func : prints ) { func(); }
+}
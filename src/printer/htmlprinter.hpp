@@ -125,12 +125,18 @@ void HtmlPrinter::collectPrints( const sys_string& path, const std::vector<searc
     // open result
     result << "<div class=\"result\">\n";
 
-    // print file path
-    result << "<a class=\"file\" href=\""
-           << uri
-           << "\" download>"
-           << uri <<
-           "</a>\n";
+    // print file path, paths within a revision are no files, so they are not linked
+    if( !opts.rev.empty() ) {
+        result << "<span class=\"file\">"
+               << HTML::encode( fromSysString( path ) )
+               << "</span>\n";
+    } else {
+        result << "<a class=\"file\" href=\""
+               << uri
+               << "\" download>"
+               << uri <<
+               "</a>\n";
+    }
 
     // parse file for newlines until last match
     long long stop = matches.back().second - content.cbegin();
@@ -159,7 +165,7 @@ void HtmlPrinter::collectPrints( const sys_string& path, const std::vector<searc
             printed = lineNo;
 
             // line in blue
-            std::string number = utils::format( "L%4i : ", lineNo + 1 );
+            std::string number = utils::format( "L%4i : ", skippedLines + lineNo + 1 );
             result << "<span class=\"line\">" << HTML::encode( number ) << "</span>";
 
             // code in neutral
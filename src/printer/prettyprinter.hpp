@@ -30,14 +30,18 @@ void PrettyPrinter::collectPrints( const sys_string& path, const std::vector<sea
     prints.clear();
     prints.reserve( 3 * matches.size() );
 
-    // print file path
+    // print file path, paths within a revision like "HEAD:src/main.cpp" are no files and printed like by git grep
+    if( !opts.rev.empty() ) {
+        prints.emplace_back( utils::printFunc( cgreen, fromSysString( path ) ) );
+    } else {
 #ifdef _WIN32
-    sys_string complete = opts.prefix + path;
-    boost::algorithm::replace_all( complete, L"\\", L"/" );
-    prints.emplace_back( utils::printFunc( cgreen, "file:///" + std::string( complete.cbegin(), complete.cend() ) ) );
+        sys_string complete = opts.prefix + path;
+        boost::algorithm::replace_all( complete, L"\\", L"/" );
+        prints.emplace_back( utils::printFunc( cgreen, "file:///" + std::string( complete.cbegin(), complete.cend() ) ) );
 #else
-    prints.emplace_back( utils::printFunc( cgreen, "file://" + opts.prefix + path ) );
+        prints.emplace_back( utils::printFunc( cgreen, "file://" + opts.prefix + path ) );
 #endif
+    }
 
     // parse file for newlines until last match
     long long stop = matches.back().second - content.cbegin();
@@ -66,7 +70,7 @@ void PrettyPrinter::collectPrints( const sys_string& path, const std::vector<sea
             printed = lineNo;
 
             // line in blue
-            std::string number = utils::format( "\nL%4i : ", lineNo + 1 );
+            std::string number = utils::format( "\nL%4i : ", skippedLines + lineNo + 1 );
             prints.emplace_back( utils::printFunc( cblue, number ) );
 
             // code in neutral
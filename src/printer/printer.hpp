@@ -11,6 +11,7 @@
 
 struct Printer {
     const SearchOptions& opts;
+    size_t skippedLines = 0; // lines before content, if a file is searched in chunks like large compressed files
     Printer( const SearchOptions& opts ) : opts( opts ) {}
     //! collect what is printed
     virtual void collectPrints( const sys_string& path, const std::vector<search::Match>& matches, const std::string_view& content ) = 0;
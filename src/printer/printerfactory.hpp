@@ -3,11 +3,20 @@
 #include "prettyprinter.hpp"
 #include "pipedprinter.hpp"
 #include "htmlprinter.hpp"
+#include "hexprinter.hpp"
 #include "searchoptions.hpp"
 
 namespace printerfactory {
 
 std::function<Printer*()> printerFunc( const SearchOptions& opts ) {
+    // lines make no sense in binaries
+    if( opts.binary ) {
+        return [&opts] {
+            HexPrinter* printer = new HexPrinter( opts );
+            return printer;
+        };
+    }
+
     if( opts.html ) {
         return [&opts] {
             HtmlPrinter* printer = new HtmlPrinter( opts );
@@ -1,10 +1,21 @@
 #include <iterator>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+#include <ctime>
 
 #include "threadpool.hpp"
 #include "searcher.hpp"
 #include "mischasan.hpp"
 #include "ssefind.hpp"
 #include "stdstr.hpp"
+#include "archive.hpp"
+#include "compression.hpp"
+#include "gitignore.hpp"
+#include "gitindex.hpp"
+#include "pipeline.hpp"
 #include "printer/printer.hpp"
 
 #define FIND_MISCHASAN    0
@@ -12,13 +23,25 @@
 #define FIND_TRAITS       2
 #define FIND_STRSTR       3
 
-std::vector<search::Match> Searcher::caseSensitiveSearch( const std::string_view& content ) {
+bool Searcher::hasLateNul( const std::string_view& content ) {
+    if( content.size() <= encoding::blockSize ) { return false; }
+
+    return memchr( content.data() + encoding::blockSize, '\0', content.size() - encoding::blockSize ) != nullptr;
+}
+
+std::vector<search::Match> Searcher::caseSensitiveSearch( const std::string_view& content, bool& binary ) {
 #if FIND_ALGO == FIND_SSE_OWN
-    return sse::find( content, term );
+    // check for \0 behind the classified block in the same pass
+    return sse::find( content, term, &binary, encoding::blockSize );
 #else
 
     std::vector<search::Match> matches;
 
+    // strstr would stop at the first \0
+    binary = hasLateNul( content );
+
+    if( binary ) { return matches; }
+
     search::Iter pos = content.cbegin();
     const char* start = content.data();
     const char* ptr = start;
@@ -63,6 +86,27 @@ std::vector<search::Match> Searcher::caseInsensitiveSearch( const std::string_vi
     return matches;
 }
 
+std::vector<search::Match> Searcher::binarySearch( const std::string_view& content ) {
+    if( opts.isRegex ) { return regexSearch( content ); }
+
+    if( !opts.ignoreCase ) { return sse::find( content, term ); }
+
+    // strcasestr would stop at the first \0
+    std::vector<search::Match> matches;
+    auto equal = []( const char a, const char b ) {
+        return tolower( static_cast<unsigned char>( a ) ) == tolower( static_cast<unsigned char>( b ) );
+    };
+
+    search::Iter pos = content.cbegin();
+
+    while( ( pos = std::search( pos, content.cend(), term.cbegin(), term.cend(), equal ) ) != content.cend() ) {
+        matches.emplace_back( pos, pos + term.size() );
+        pos += term.size();
+    }
+
+    return matches;
+}
+
 std::vector<search::Match> Searcher::regexSearch( const std::string_view& content ) {
     std::vector<search::Match> matches;
 
@@ -81,19 +125,568 @@ std::vector<search::Match> Searcher::regexSearch( const std::string_view& conten
     return matches;
 }
 
+namespace {
+//! runs jobs on the calling thread, for pools which don't accept jobs from their workers
+struct InlinePool {
+    void add( const std::function<void()>& job ) { job(); }
+};
+
+//! \returns CPUs of utils::cpuCount, checked once
+size_t cpus() {
+    static const size_t count = utils::cpuCount();
+    return count;
+}
+
+#if THREADPOOL == OWN_THREADPOOL && DETAILED_STATS
+//! \returns workers of the pool, threads of -j or enough to keep the CPUs busy while most workers wait for the disk,
+//! which only search with --pipeline
+size_t poolSize( const SearchOptions& opts ) {
+    if( opts.threads ) { return opts.threads; }
+
+    return opts.pipeline ? cpus() : 4 * cpus();
+}
+
+//! adapts the active workers of an automatic pool to the load, starting with one per CPU
+//! while the CPUs idle and reading takes longer than searching, the workers wait for the disk,
+//! so more of them keep more reads in flight, while the CPUs are saturated, the extra ones only contend
+class Balancer {
+    public:
+        Balancer( ThreadPool& pool, const Stats& stats, const bool adaptive ) : pool( pool ) {
+            if( !adaptive || pool.size() <= cpus() ) { return; }
+
+            pool.limit( cpus() );
+            balancer = std::thread( [&stats, this] { balance( stats ); } );
+        }
+
+        //! joins the pool first, so the workers are balanced until the last job
+        ~Balancer() {
+            if( !balancer.joinable() ) { return; }
+
+            pool.join();
+            {
+                std::unique_lock<std::mutex> lock( m );
+                stopped = true;
+            }
+            cv.notify_one();
+            balancer.join();
+        }
+
+    private:
+        void balance( const Stats& stats ) {
+            using clock = std::chrono::steady_clock;
+            const auto interval = std::chrono::milliseconds( 20 );
+            long long read = 0;
+            long long search = 0;
+            std::clock_t cpu = std::clock();
+            clock::time_point wall = clock::now();
+            std::unique_lock<std::mutex> lock( m );
+
+            while( !cv.wait_for( lock, interval, [this] { return stopped; } ) ) {
+                const long long reading = stats.t_read - read;
+                const long long searching = stats.t_search - search;
+                read += reading;
+                search += searching;
+
+                // share of the CPUs used since the last check
+                const std::clock_t cpuNow = std::clock();
+                const clock::time_point wallNow = clock::now();
+                const double used = double( cpuNow - cpu ) / CLOCKS_PER_SEC
+                                    / ( std::chrono::duration<double>( wallNow - wall ).count() * cpus() );
+                cpu = cpuNow;
+                wall = wallNow;
+
+                // nothing read or searched, the walkers are still listing the first directories
+                if( !reading && !searching ) { continue; }
+
+                const size_t active = pool.active();
+
+                if( used < 0.75 && reading > searching ) {
+                    pool.limit( active + std::max<size_t>( active / 4, 1 ) );
+                } else if( used > 0.95 && active > cpus() ) {
+                    pool.limit( std::max( active - std::max<size_t>( active / 4, 1 ), cpus() ) );
+                }
+            }
+        }
+
+        ThreadPool& pool;
+        std::mutex m;
+        std::condition_variable cv;
+        bool stopped = false;
+        std::thread balancer;
+};
+#else
+size_t poolSize( const SearchOptions& opts ) {
+    return opts.threads ? opts.threads : cpus();
+}
+
+//! only the own pool can change its active workers
+struct Balancer {
+    template<class Pool>
+    Balancer( Pool&, const Stats&, const bool ) {}
+};
+#endif
+
+#if THREADPOOL == OWN_THREADPOOL
+//! with --pin, binds the workers of pool to the CPUs, the first ones one per CPU and spread over the NUMA nodes,
+//! so the workers of the Balancer use the memory bandwidth of all nodes
+void pin( ThreadPool& pool, const SearchOptions& opts ) {
+    if( opts.pin ) { pool.pin( utils::cpuOrder() ); }
+}
+#else
+//! only the own pool can pin its workers
+template<class Pool>
+void pin( Pool&, const SearchOptions& ) {}
+#endif
+
+//! files searched by one job, their paths packed into one buffer
+//! \note batches are recycled, so their buffers are allocated once and only grow
+struct Batch {
+    static constexpr size_t files = 64;          // files per job
+    static constexpr size_t budget = 256 * 1024; // expected bytes per job, larger files get a job of their own
+    sys_string paths;                            // each path followed by a \0
+    std::vector<size_t> sizeHints;               // expected sizes, 0 if unknown
+    std::vector<gitindex::Entry> indexed;        // with --changed, entries, whose stat data decides, if a file is searched
+    std::vector<uint64_t> inodes;                // from the directory entry or the index, 0 if unknown
+    size_t bytes = 0;                            // sum of sizeHints
+
+    bool empty() const { return sizeHints.empty(); }
+    bool full() const { return sizeHints.size() >= files || bytes >= budget; }
+    //! \returns true, if a file of sizeHint would push the batch over its budget
+    bool exceeds( const size_t sizeHint ) const { return !empty() && bytes + sizeHint > budget; }
+
+    void add( const sys_string& path, const size_t sizeHint, const gitindex::Entry* entry = nullptr, const uint64_t inode = 0 ) {
+        if( entry ) {
+            indexed.resize( sizeHints.size() );
+            indexed.push_back( *entry );
+        }
+
+        paths.append( path );
+        paths.push_back( 0 );
+        sizeHints.push_back( sizeHint );
+        inodes.push_back( inode );
+        bytes += sizeHint;
+    }
+
+    //! reorders the files by inode, on most filesystems the inodes of a directory are allocated near their data,
+    //! so a spinning disk seeks forward instead of back and forth in the hash order of the directory
+    void sortByInode() {
+        // scratch space of the calling worker, whose buffers are swapped with the ones of this batch
+        static thread_local Batch sorted;
+        static thread_local std::vector<std::pair<uint64_t, size_t>> order; // inode and index of each file
+        static thread_local std::vector<size_t> offsets;                    // of each path
+        order.clear();
+        offsets.clear();
+
+        for( size_t i = 0, from = 0; i < inodes.size(); ++i ) {
+            order.emplace_back( inodes[i], i );
+            offsets.push_back( from );
+            from = paths.find( sys_string::value_type( 0 ), from ) + 1;
+        }
+
+        // stable, so files without inode stay in walk order
+        std::stable_sort( order.begin(), order.end(), []( const auto & a, const auto & b ) { return a.first < b.first; } );
+
+        sorted.clear();
+
+        for( const auto& [inode, i] : order ) {
+            if( i < indexed.size() && !indexed[i].path.empty() ) {
+                sorted.indexed.resize( sorted.sizeHints.size() );
+                sorted.indexed.push_back( indexed[i] );
+            }
+
+            // up to the \0 of the path
+            sorted.paths.append( paths.c_str() + offsets[i] );
+            sorted.paths.push_back( 0 );
+            sorted.sizeHints.push_back( sizeHints[i] );
+            sorted.inodes.push_back( inode );
+        }
+
+        std::swap( paths, sorted.paths );
+        std::swap( sizeHints, sorted.sizeHints );
+        std::swap( indexed, sorted.indexed );
+        std::swap( inodes, sorted.inodes );
+    }
+
+    //! calls callback with each path, its size hint and index entry or nullptr
+    template<class Callback>
+    void forEach( Callback callback ) const {
+        // reused for each path, so its capacity is allocated once
+        sys_string path;
+        size_t from = 0;
+
+        for( size_t i = 0; i < sizeHints.size(); ++i ) {
+            const size_t to = paths.find( sys_string::value_type( 0 ), from );
+            path.assign( paths, from, to - from );
+            from = to + 1;
+            callback( path, sizeHints[i], i < indexed.size() && !indexed[i].path.empty() ? &indexed[i] : nullptr );
+        }
+    }
+
+    void clear() {
+        paths.clear();
+        sizeHints.clear();
+        indexed.clear();
+        inodes.clear();
+        bytes = 0;
+    }
+};
+
+//! free list of batches, shared by all walkers and workers
+class Batches {
+    public:
+        ~Batches() {
+            for( Batch* batch : spare ) { delete batch; }
+        }
+
+        Batch* get() {
+            {
+                std::unique_lock<std::mutex> lock( m );
+
+                if( !spare.empty() ) {
+                    Batch* batch = spare.back();
+                    spare.pop_back();
+                    return batch;
+                }
+            }
+
+            return new Batch();
+        }
+
+        void put( Batch* batch ) {
+            batch->clear();
+            std::unique_lock<std::mutex> lock( m );
+            spare.push_back( batch );
+        }
+
+    private:
+        std::mutex m;
+        std::vector<Batch*> spare;
+};
+
+Batches batches;
+
+// batch, which the walker on this thread fills with the files of its current directory
+thread_local Batch* pending = nullptr;
+
+//! searches the files of batch in one job on pool and recycles batch
+template<class Pool>
+void submit( Pool& pool, Searcher& searcher, Batch*& batch ) {
+    if( !batch ) { return; }
+
+    pool.add( [batch, &searcher] {
+        if( searcher.inodeOrder ) { batch->sortByInode(); }
+
+        batch->forEach( [&searcher]( const sys_string & path, const size_t sizeHint, const gitindex::Entry * indexed ) {
+            // the worker compares the stat data, so the lstat calls run in parallel
+            if( indexed && !gitindex::isModified( *indexed, path ) ) { return; }
+
+            searcher.stats.filesSearched++;
+            searcher.search( path, sizeHint );
+        } );
+
+        batches.put( batch );
+    } );
+
+    batch = nullptr;
+}
+
+//! file read by the I/O stage of --pipeline for the search stage
+struct Read {
+    utils::Buffer buffer;
+    utils::FileView view;
+    sys_string path;
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+};
+
+//! walker and I/O stage of --pipeline, pool is the search stage
+//! walkers wait, while the readers have enough batches queued, and readers wait for a free read,
+//! so memory stays flat, however far the walkers are ahead of slow reads on network filesystems
+template<class Pool>
+struct Pipeline {
+    Pool& pool;
+    pipeline::Limit queued;      // batches for the readers
+    pipeline::Slots<Read> reads; // files read, but not searched yet
+    ThreadPool readers;
+    ThreadPool walkers;
+
+    Pipeline( Pool& pool, const size_t io, const size_t searchers ) :
+        pool( pool ), queued( 2 * io ), reads( io + 2 * searchers ), readers( io ), walkers( io ) {}
+
+    //! waits for all stages, the search jobs on pool release their reads last
+    ~Pipeline() {
+        walkers.join();
+        readers.join();
+        reads.drain();
+    }
+};
+
+//! reads the files of batch in one job on the readers, each file is searched in its own job on the pool
+template<class Pool>
+void submit( Pipeline<Pool>& stages, Searcher& searcher, Batch*& batch ) {
+    if( !batch ) { return; }
+
+    stages.queued.acquire();
+    stages.readers.add( [batch, &stages, &searcher] {
+        if( searcher.inodeOrder ) { batch->sortByInode(); }
+
+        batch->forEach( [&stages, &searcher]( const sys_string & path, const size_t sizeHint, const gitindex::Entry * indexed ) {
+            if( indexed && !gitindex::isModified( *indexed, path ) ) { return; }
+
+            searcher.stats.filesSearched++;
+            Read* read = stages.reads.acquire();
+
+            if( !searcher.read( path, sizeHint, read->view, read->dev, read->ino, &read->buffer ) ) {
+                stages.reads.release( read );
+                return;
+            }
+
+            read->path = path;
+            stages.pool.add( [read, &stages, &searcher] {
+                searcher.searchView( read->path, read->view, read->dev, read->ino );
+                stages.reads.release( read );
+            } );
+        } );
+
+        batches.put( batch );
+        stages.queued.release();
+    } );
+
+    batch = nullptr;
+}
+
+//! \returns readers and walkers of --pipeline, --io-threads or enough to keep many reads in flight
+size_t ioThreads( const SearchOptions& opts ) {
+    return opts.ioThreads ? opts.ioThreads : std::max<size_t>( 8, 2 * cpus() );
+}
+
+//! pool and background readers of --cached-first, pool searches the files in the page cache right away,
+//! the readers wait for the disk and search the other files, so the first results don't wait for the disk
+//! \note the readers must outlive pool, whose jobs add to them until the walk is done
+template<class Pool>
+struct CachedFirst {
+    Pool& pool;
+    ThreadPool& readers;
+};
+
+//! searches the files of batch in the page cache in one job on pool, each other file in a job on the readers
+template<class Pool>
+void submit( CachedFirst<Pool>& stages, Searcher& searcher, Batch*& batch ) {
+    if( !batch ) { return; }
+
+    stages.pool.add( [batch, &stages, &searcher] {
+        if( searcher.inodeOrder ) { batch->sortByInode(); }
+
+        batch->forEach( [&stages, &searcher]( const sys_string & path, const size_t sizeHint, const gitindex::Entry * indexed ) {
+            if( indexed && !gitindex::isModified( *indexed, path ) ) { return; }
+
+            searcher.stats.filesSearched++;
+            uint64_t dev = 0;
+            uint64_t ino = 0;
+
+            if( !searcher.visit( path, dev, ino ) ) { return; }
+
+            utils::FileView view;
+
+            if( searcher.fetch( path, sizeHint, view, nullptr, true ) ) {
+                searcher.searchView( path, view, dev, ino );
+                return;
+            }
+
+            if( !view.uncached ) { return; }
+
+            searcher.stats.filesUncached++;
+            stages.readers.add( [path, sizeHint, dev, ino, &searcher] {
+                utils::FileView uncached;
+
+                if( searcher.fetch( path, sizeHint, uncached, nullptr ) ) { searcher.searchView( path, uncached, dev, ino ); }
+            } );
+        } );
+
+        batches.put( batch );
+    } );
+
+    batch = nullptr;
+}
+
+//! batches of the git index, held back until the index is read, then submitted longest first,
+//! so the largest files don't end up alone on one worker at the end, while the small ones fill the gaps
+struct LargestFirst {
+    std::vector<Batch*> held;
+
+    template<class Pool>
+    void submit( Pool& pool, Searcher& searcher ) {
+        std::stable_sort( held.begin(), held.end(), []( const Batch * a, const Batch * b ) { return a->bytes > b->bytes; } );
+
+        for( Batch* batch : held ) { ::submit( pool, searcher, batch ); }
+
+        held.clear();
+    }
+};
+
+void submit( LargestFirst& sorted, Searcher&, Batch*& batch ) {
+    if( !batch ) { return; }
+
+    sorted.held.push_back( batch );
+    batch = nullptr;
+}
+
+//! adds path to batch, which is submitted, once it is full, files over the budget of batch are submitted alone
+template<class Pool>
+void collect( Pool& pool, Searcher& searcher, Batch*& batch, const sys_string& path, const size_t sizeHint = 0,
+              const gitindex::Entry* indexed = nullptr, const uint64_t inode = 0 ) {
+    if( batch && batch->exceeds( sizeHint ) ) { submit( pool, searcher, batch ); }
+
+    if( !batch ) { batch = batches.get(); }
+
+    batch->add( path, sizeHint, indexed, inode );
+
+    if( batch->full() ) { submit( pool, searcher, batch ); }
+}
+
+//! \returns size of root including a trailing separator
+size_t rootSize( const sys_string& root ) {
+    return root.size() + ( root.back() == '/' || root.back() == '\\' ? 0 : 1 );
+}
+}
+
+// std::async pool is not thread safe, so directories are listed on this thread
+// else subdirectories are listed by the workers between the files
+#if THREADPOOL == ASYNC_THREADPOOL
+#define WALKERS InlinePool walkers;
+#else
+#define WALKERS auto& walkers = pool;
+#endif
+
+std::function<bool( const sys_string& )> Searcher::descend() const {
+    if( !filter ) { return nullptr; }
+
+    return [filter = filter]( const sys_string & dirname ) { return filter->listedDir( dirname ); };
+}
+
+template<class Pool, class Walkers>
+void Searcher::searchRepo( Pool& pool, Walkers& walkers, const sys_string& root, const size_t strip, const bool nested ) {
+    const size_t size = rootSize( root );
+    const fs::path gitDir = gitindex::gitDir( root );
+
+    // with --changed, blobs of the base tree, unchanged files have the same blob in the index and matching stat data
+    std::unordered_map<std::string, gitobjects::Oid> base;
+    const bool changedOnly = !opts.changedSince.empty();
+
+    if( changedOnly ) {
+        const gitobjects::Repo repo( gitDir );
+        gitobjects::Oid oid;
+
+        // submodules and nested repos may not have the revision of the main repo, their HEAD is the base then
+        const bool resolved = repo.resolve( opts.changedSince, oid ) || ( nested && repo.resolve( "HEAD", oid ) );
+
+        if( !resolved && !nested ) {
+            LOG( "Unknown revision: " << opts.changedSince );
+            exit( EXIT_FAILURE );
+        }
+
+        if( resolved ) {
+            repo.walkTree( oid, [&base]( const std::string & path, const gitobjects::Oid & blob, const uint32_t ) {
+                base.emplace( path, blob );
+            } );
+        }
+    }
+
+    // tracked files relative to the repo, shared with the walkers
+    auto tracked = std::make_shared<std::unordered_set<std::string>>();
+    const sys_string prefix = root.substr( std::min( strip, root.size() ) );
+
+    // the globs are relative to the search folder, nested repos are somewhere below
+    std::string inSearch = filter ? gitignore::relative( root, filter->root ) : std::string();
+
+    if( !inSearch.empty() ) { inSearch.push_back( '/' ); }
+
+    // tracked files come from the index with their size, so nothing is left to stat and they are searched largest first
+    LargestFirst sorted;
+    Batch* batch = nullptr;
+    const bool indexed = gitindex::read( gitDir, [&sorted, &batch, &tracked, &base, &prefix, &inSearch, changedOnly, this]( const gitindex::Entry & entry ) {
+        tracked->insert( entry.path );
+
+        // skip-worktree files are not checked out in sparse checkouts, submodules are searched by the walk
+        if( !entry.isFile() || ( entry.extended & gitindex::Entry::skipWorktree ) ) { return; }
+
+        if( filter && !filter->file( inSearch + entry.path, true ) ) { return; }
+
+        // files with the same blob as in the base tree may still have unstaged changes
+        const auto it = base.find( entry.path );
+        const bool unstaged = changedOnly && it != base.cend() && it->second == entry.oid;
+
+        collect( sorted, *this, batch, ( fs::path( prefix ) / entry.path ).native(), entry.size, unstaged ? &entry : nullptr, entry.ino );
+    } );
+    submit( sorted, *this, batch );
+    sorted.submit( pool, *this );
+
+    // untracked files, which are not ignored
+    auto onFile = [&pool, tracked, indexed, size, strip, this]( const sys_string & filename ) {
+        if( indexed && tracked->count( gitignore::relative( filename, size ) ) ) { return; }
+
+        if( filter && !filter->listedFile( filename ) ) { return; }
+
+        collect( pool, *this, pending, filename.substr( strip ), 0, nullptr, utils::listedInode );
+    };
+
+    auto onListed = [&pool, this] { submit( pool, *this, pending ); };
+
+    // each nested repo is listed in its own job, concurrently with this walk
+    auto onRepo = [&pool, &walkers, strip, this]( const sys_string & dirname ) {
+        walkers.add( [&pool, &walkers, dirname, strip, this] {
+            searchRepo( pool, walkers, dirname, strip, true );
+        } );
+    };
+
+    gitignore::recurseDirParallel( walkers, root, size, gitignore::fromRepo( root ), onFile, onRepo, descend(), onListed );
+}
+
+template<class Pool, class Walkers>
+void Searcher::searchFolder( Pool& pool, Walkers& walkers, const sys_string& root ) {
+    auto onFile = [&pool, this]( const sys_string & filename ) {
+        if( filter && !filter->listedFile( filename ) ) { return; }
+
+        collect( pool, *this, pending, filename, 0, nullptr, utils::listedInode );
+    };
+
+    auto onListed = [&pool, this] { submit( pool, *this, pending ); };
+
+    if( opts.noGit ) {
+        utils::recurseDirParallel( walkers, root, onFile, descend(), onListed );
+    } else {
+        // .gitignore files are honored outside of repos, too, repos in the folder are searched like with git
+        auto onRepo = [&pool, &walkers, this]( const sys_string & dirname ) {
+            walkers.add( [&pool, &walkers, dirname, this] { searchRepo( pool, walkers, dirname, 0, true ); } );
+        };
+
+        gitignore::recurseDirParallel( walkers, root, rootSize( root ), nullptr, onFile, onRepo, descend(), onListed );
+    }
+}
+
 void Searcher::onAllFiles() {
     this->printHeader();
 
-    POOL;
+    // declared before the pool, so the readers of --cached-first are joined after it
+    ThreadPool readers( ioThreads( opts ) );
+    POOL( poolSize( opts ) );
+    pin( pool, opts );
+    Balancer balancer( pool, stats, !opts.threads && !opts.pipeline );
+    WALKERS;
     STOPWATCH
     START
 
-    utils::recurseDir( opts.path.native(), [&pool, this]( const sys_string & filename ) {
-        pool.add( [filename, this] {
-            stats.filesSearched++;
-            search( filename );
-        } );
-    } );
+    const sys_string& root = opts.path.native();
+
+    if( opts.pipeline ) {
+        Pipeline<std::remove_reference_t<decltype( pool )>> stages( pool, ioThreads( opts ), poolSize( opts ) );
+        searchFolder( stages, stages.walkers, root );
+    } else if( opts.cachedFirst ) {
+        CachedFirst<std::remove_reference_t<decltype( pool )>> cached{ pool, readers };
+        searchFolder( cached, walkers, root );
+    } else {
+        searchFolder( pool, walkers, root );
+    }
 
     STOP( stats.t_recurse )
 }
@@ -101,29 +694,95 @@ void Searcher::onAllFiles() {
 void Searcher::onGitFiles() {
     this->printGitHeader();
 
-    POOL;
+    // declared before the pool, so the readers of --cached-first are joined after it
+    ThreadPool readers( ioThreads( opts ) );
+    POOL( poolSize( opts ) );
+    pin( pool, opts );
+    Balancer balancer( pool, stats, !opts.threads && !opts.pipeline );
+    WALKERS;
     STOPWATCH
     START
 
-    utils::gitLsFiles( opts.path, [&pool, this]( const sys_string & filename ) {
-        pool.add( [filename, this] {
-            stats.filesSearched++;
-            search( filename );
-        } );
+    // search with paths relative to the repo like git ls-files
+    fs::current_path( opts.path );
+    const sys_string& root = opts.path.native();
+
+    if( opts.pipeline ) {
+        Pipeline<std::remove_reference_t<decltype( pool )>> stages( pool, ioThreads( opts ), poolSize( opts ) );
+        searchRepo( stages, stages.walkers, root, rootSize( root ), false );
+    } else if( opts.cachedFirst ) {
+        CachedFirst<std::remove_reference_t<decltype( pool )>> cached{ pool, readers };
+        searchRepo( cached, walkers, root, rootSize( root ), false );
+    } else {
+        searchRepo( pool, walkers, root, rootSize( root ), false );
+    }
+
+    STOP( stats.t_recurse );
+}
+
+void Searcher::onRevFiles() {
+    this->printRevHeader();
+
+    const gitobjects::Repo repo( gitindex::gitDir( opts.path ) );
+    gitobjects::Oid oid;
+
+    if( !repo.resolve( opts.rev, oid ) ) {
+        LOG( "Unknown revision: " << opts.rev );
+        exit( EXIT_FAILURE );
+    }
+
+    POOL( poolSize( opts ) );
+    pin( pool, opts );
+    Balancer balancer( pool, stats, !opts.threads && !opts.pipeline );
+    STOPWATCH
+    START
+
+    // paths like "v1.0:src/main.cpp" like git grep, grouped by blob
+    std::map<gitobjects::Oid, std::vector<sys_string>> blobs;
+    const bool complete = repo.walkTree( oid, [&blobs, this]( const std::string & path, const gitobjects::Oid & blob, const uint32_t mode ) {
+        // regular files only, symlinks point into the worktree and submodules are other repos
+        if( ( mode >> 12 ) != 010 ) { return; }
+
+        if( filter && !filter->file( path, true ) ) { return; }
+
+        const std::string name = opts.rev + ":" + path;
+        blobs[blob].push_back( sys_string( name.cbegin(), name.cend() ) );
     } );
 
+    if( !complete ) {
+        LOG( "Corrupt or missing objects in revision: " << opts.rev );
+    }
+
     STOP( stats.t_recurse );
+
+    for( auto& [blob, paths] : blobs ) {
+        stats.filesDeduplicated += paths.size() - 1;
+        pool.add( [&repo, blob = blob, paths = std::move( paths ), this] {
+            stats.filesSearched += paths.size();
+            searchBlob( repo, blob, paths );
+        } );
+    }
 }
 
 void Searcher::printHeader() {
     if( !opts.piped ) {
-        utils::printColor( gray, utils::format( "Searching for \"%s\" in folder:\n\n", opts.term.c_str() ) );
+        utils::printColor( gray, utils::format( "Searching for \"%s\" in folder:\n\n", displayTerm().c_str() ) );
     }
 }
 
 void Searcher::printGitHeader() {
     if( !opts.piped ) {
-        utils::printColor( gray, utils::format( "Searching for \"%s\" in git repo:\n\n", opts.term.c_str() ) );
+        if( opts.changedSince.empty() ) {
+            utils::printColor( gray, utils::format( "Searching for \"%s\" in git repo:\n\n", displayTerm().c_str() ) );
+        } else {
+            utils::printColor( gray, utils::format( "Searching for \"%s\" in files changed since %s:\n\n", displayTerm().c_str(), opts.changedSince.c_str() ) );
+        }
+    }
+}
+
+void Searcher::printRevHeader() {
+    if( !opts.piped ) {
+        utils::printColor( gray, utils::format( "Searching for \"%s\" in git revision %s:\n\n", displayTerm().c_str(), opts.rev.c_str() ) );
     }
 }
 
@@ -137,6 +796,32 @@ void Searcher::printStats() {
                                stats.t_collect / 1000000,
                                stats.t_print / 1000000 ) );
 
+        if( stats.filesBinary ) {
+            utils::printColor( gray, utils::format( "Binaries: %lu files skipped\n", stats.filesBinary.load() ) );
+        }
+
+        if( stats.filesArchived ) {
+            utils::printColor( gray, utils::format( "Archives: %lu members searched\n", stats.filesArchived.load() ) );
+        }
+
+        if( stats.filesDeduplicated ) {
+            utils::printColor( gray, utils::format( "Duplicates: %lu files with the same content as another file\n", stats.filesDeduplicated.load() ) );
+        }
+
+        if( stats.filesUncached ) {
+            utils::printColor( gray, utils::format( "Uncached: %lu files read in the background\n", stats.filesUncached.load() ) );
+        }
+
+        if( stats.filesTranscoded ) {
+            utils::printColor( gray, utils::format( "Transcoded: %lu UTF-16 or Latin-1 files\n", stats.filesTranscoded.load() ) );
+        }
+
+        if( stats.bytesHuge ) {
+            utils::printColor( gray, utils::format(
+                                   "Huge pages: %lu/%lu kB read into huge page buffers\n",
+                                   stats.bytesHuge.load() / 1024,
+                                   stats.bytesRead.load() / 1024 ) );
+        }
     }
 }
 
@@ -152,54 +837,335 @@ void Searcher::printFooter( const StopWatch::ns_type& ms ) {
     }
 }
 
-void Searcher::search( const sys_string& path ) {
+void Searcher::search( const sys_string& path, const size_t sizeHint ) {
+    utils::FileView view;
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+
+    if( read( path, sizeHint, view, dev, ino ) ) { searchView( path, view, dev, ino ); }
+}
+
+bool Searcher::read( const sys_string& path, const size_t sizeHint, utils::FileView& view, uint64_t& dev, uint64_t& ino,
+                     utils::Buffer* buffer ) {
+    return visit( path, dev, ino ) && fetch( path, sizeHint, view, buffer );
+}
+
+bool Searcher::visit( const sys_string& path, uint64_t& dev, uint64_t& ino ) {
+    // with -L, the same file may be listed through several links, or tracked as a link and as a file
+    if( utils::Links::follow && !utils::Links::visit( path ) ) {
+        stats.filesDeduplicated++;
+        return false;
+    }
+
+    // with --dedup, hardlinks of a file without matches are not read again
+    dev = 0;
+    ino = 0;
 
+    if( opts.dedup && utils::fileId( path, dev, ino ) ) {
+        const dedup::ResultPtr known = duplicates.byInode( dev, ino );
+
+        if( known && known->done.load( std::memory_order_acquire ) && known->matches.empty() ) {
+            stats.filesDeduplicated++;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Searcher::fetch( const sys_string& path, const size_t sizeHint, utils::FileView& view, utils::Buffer* buffer, const bool nowait ) {
     STOPWATCH
     START
 
+    utils::ReadOptions options = readOptions;
+    options.sizeHint = sizeHint;
+    // compressed files are decompressed while they are searched, see searchCompressed
+    options.deferred = buffer != nullptr || readOptions.decompress;
+    options.nowait = nowait;
+
 #ifndef _WIN32
-    utils::FileView view = utils::fromFileP( path );
+    view = buffer ? utils::fromFileP( path, options, *buffer ) : utils::fromFileP( path, options );
 #else
-    utils::FileView view = utils::fromWinAPI( path );
+    view = buffer ? utils::fromWinAPI( path, options, *buffer ) : utils::fromWinAPI( path, options );
 #endif
 
     stats.bytesRead += view.size;
+
+    if( view.huge ) { stats.bytesHuge += view.size; }
+
+    if( view.size && encoding::needsTranscoding( view.encoding ) ) { stats.filesTranscoded++; }
+
     STOP( stats.t_read )
 
-    if( !view.size ) { return; }
+    if( !view.size ) {
+        if( view.encoding == encoding::Encoding::Binary ) { stats.filesBinary++; }
+
+        return false;
+    }
+
+    return true;
+}
+
+void Searcher::searchView( const sys_string& path, utils::FileView& view, const uint64_t dev, const uint64_t ino ) {
+    if( view.compressed ) {
+        searchCompressed( path, view.content, dev, ino );
+        return;
+    }
+
+    if( !utils::finish( view, readOptions ) ) {
+        if( view.encoding == encoding::Encoding::Binary ) { stats.filesBinary++; }
+
+        return;
+    }
 
-    // collect matches
+    if( view.archive ) {
+        searchArchive( path, view.content );
+    } else if( opts.dedup ) {
+        searchUnique( path, view.content, dev, ino );
+    } else {
+        searchContent( path, view.content );
+    }
+}
+
+void Searcher::searchCompressed( const sys_string& path, const std::string_view& compressed, const uint64_t dev, const uint64_t ino ) {
+    // output of one chunk at a time for each thread, or of the whole file
+    static thread_local utils::Buffer buffer;
+    compression::Stream stream( compression::detect( compressed ), compressed );
+    buffer.size = 0;
+
+    // decompression counts as read, corrupt files are skipped
+    STOPWATCH
     START
-    const std::string_view& content = view.content;
-    std::vector<search::Match> matches;
+    const bool ok = stream.read( buffer, chunkSize );
+    STOP( stats.t_read );
+
+    if( !ok ) { return; }
+
+    // compressed files turn out to be binaries or archives only now
+    utils::FileView view;
+    view.content = std::string_view( buffer.ptr, buffer.size );
+    view.archive = readOptions.archives && archive::detect( view.content ) != archive::Format::None;
+
+    if( !view.archive && !opts.binary ) { view.encoding = encoding::classify( view.content ); }
 
-    if( !opts.isRegex ) {
-        if( opts.ignoreCase ) {
-            matches = caseInsensitiveSearch( content );
+    if( view.encoding == encoding::Encoding::Binary ) {
+        stats.filesBinary++;
+        return;
+    }
+
+    if( encoding::needsTranscoding( view.encoding ) ) { stats.filesTranscoded++; }
+
+    // archives, binaries and UTF-16 can not be cut at line ends, so they are searched whole like small outputs
+    if( stream.finished() || view.archive || opts.binary || !encoding::isAsciiCompatible( view.encoding ) ) {
+        START
+        const bool whole = stream.finished() || stream.read( buffer, SIZE_MAX );
+        STOP( stats.t_read );
+
+        if( !whole ) { return; }
+
+        view.size = buffer.size;
+        view.content = std::string_view( buffer.ptr, buffer.size );
+
+        if( view.archive ) {
+            searchArchive( path, view.content );
+        } else if( !utils::transcode( view ) ) {
+            return;
+        } else if( opts.dedup ) {
+            searchUnique( path, view.content, dev, ino );
         } else {
-            matches = caseSensitiveSearch( content );
+            searchContent( path, view.content );
+        }
+
+        return;
+    }
+
+    // larger outputs are searched in chunks, the last partial line of each chunk is moved to the next one
+    size_t lines = 0;
+    bool first = true;
+    bool matched = false;
+
+    for( ;; ) {
+        std::string_view chunk( buffer.ptr, buffer.size );
+        const size_t end = chunk.rfind( '\n' );
+
+        // a chunk without line end is one long line, which is split
+        if( !stream.finished() && end != std::string_view::npos ) { chunk = chunk.substr( 0, end + 1 ); }
+
+        // the first block of each later chunk is not classified, so it is checked for \0 here
+        if( !first && memchr( chunk.data(), '\0', std::min( chunk.size(), encoding::blockSize ) ) ) {
+            stats.filesBinary++;
+            return;
+        }
+
+        view.content = chunk;
+
+        if( !utils::transcode( view ) ) { return; }
+
+        bool binary = false;
+        const std::vector<search::Match> matches = findMatches( view.content, binary );
+
+        if( binary ) {
+            stats.filesBinary++;
+            return;
+        }
+
+        if( !matches.empty() ) {
+            if( !matched ) { stats.filesMatched++; }
+
+            matched = true;
+            stats.matches += matches.size();
+            printPath( path, view.content, matches, lines );
         }
+
+        if( stream.finished() ) { return; }
+
+        lines += std::count( chunk.cbegin(), chunk.cend(), '\n' );
+        first = false;
+
+        const size_t rest = buffer.size - chunk.size();
+        memmove( buffer.ptr, buffer.ptr + chunk.size(), rest );
+        buffer.size = rest;
+
+        START
+        const bool next = stream.read( buffer, chunkSize );
+        STOP( stats.t_read );
+
+        if( !next ) { return; }
+    }
+}
+
+void Searcher::searchArchive( const sys_string& path, const std::string_view& content ) {
+    // members are inflated or copied into this buffer
+    static thread_local utils::Buffer buffer;
+
+    archive::walk( content, buffer, [&path, this]( const std::string & name, const std::string_view & member ) {
+        stats.filesArchived++;
+
+        if( member.empty() ) { return; }
+
+        searchMemory( path + archive::separator + sys_string( name.cbegin(), name.cend() ), member );
+    } );
+}
+
+void Searcher::searchBlob( const gitobjects::Repo& repo, const gitobjects::Oid& oid, const std::vector<sys_string>& paths ) {
+    // blobs are inflated into this buffer
+    static thread_local utils::Buffer buffer;
+
+    STOPWATCH
+    START
+
+    if( repo.read( oid, buffer ) != gitobjects::Type::Blob ) { return; }
+
+    stats.bytesRead += buffer.size;
+
+    STOP( stats.t_read )
+
+    if( !buffer.size ) { return; }
+
+    searchMemory( paths.front(), std::string_view( buffer.ptr, buffer.size ),
+                  std::vector<sys_string>( paths.cbegin() + 1, paths.cend() ) );
+}
+
+void Searcher::searchMemory( const sys_string& path, const std::string_view& content, const std::vector<sys_string>& aliases ) {
+    utils::FileView view;
+    view.size = content.size();
+    view.content = content;
+
+    if( !opts.binary ) { view.encoding = encoding::classify( content ); }
+
+    if( view.encoding == encoding::Encoding::Binary ) {
+        stats.filesBinary += 1 + aliases.size();
+        return;
+    }
+
+    if( encoding::needsTranscoding( view.encoding ) ) { stats.filesTranscoded++; }
+
+    if( !utils::transcode( view ) ) { return; }
+
+    searchContent( path, view.content, aliases );
+}
+
+void Searcher::searchContent( const sys_string& path, const std::string_view& content, const std::vector<sys_string>& aliases ) {
+    bool binary = false;
+    const std::vector<search::Match> matches = findMatches( content, binary );
+    printMatches( path, content, matches, binary, aliases );
+}
+
+void Searcher::searchUnique( const sys_string& path, const std::string_view& content, const uint64_t dev, const uint64_t ino ) {
+    bool first = false;
+    const dedup::ResultPtr result = duplicates.byContent( content, dev, ino, first );
+
+    // copies read while the first one is still searched are searched, too
+    if( !result || first || !result->done.load( std::memory_order_acquire ) ) {
+        bool binary = false;
+        const std::vector<search::Match> matches = findMatches( content, binary );
+
+        if( first ) { result->set( matches, content, binary ); }
+
+        printMatches( path, content, matches, binary );
+        return;
+    }
+
+    stats.filesDeduplicated++;
+    printMatches( path, content, result->get( content ), result->binary );
+}
+
+std::vector<search::Match> Searcher::findMatches( const std::string_view& content, bool& binary ) {
+    STOPWATCH
+    START
+    std::vector<search::Match> matches;
+    binary = false;
+
+    if( opts.binary ) {
+        matches = binarySearch( content );
+    } else if( !opts.isRegex && !opts.ignoreCase ) {
+        matches = caseSensitiveSearch( content, binary );
     } else {
-        matches = regexSearch( content );
+        binary = hasLateNul( content );
+
+        if( !binary ) {
+            matches = opts.isRegex ? regexSearch( content ) : caseInsensitiveSearch( content );
+        }
     }
 
     STOP( stats.t_search );
+    return matches;
+}
+
+void Searcher::printMatches( const sys_string& path, const std::string_view& content, const std::vector<search::Match>& matches,
+                             const bool binary, const std::vector<sys_string>& aliases ) {
+    // binary with \0 behind the first block
+    if( binary ) {
+        stats.filesBinary += 1 + aliases.size();
+        return;
+    }
 
     // handle matches
     if( !matches.empty() ) {
-        stats.filesMatched++;
-        stats.matches += matches.size();
+        stats.filesMatched += 1 + aliases.size();
+        stats.matches += matches.size() * ( 1 + aliases.size() );
 
-        START
-        static thread_local std::unique_ptr<Printer> printer( makePrinter() );
-        printer->collectPrints( path, matches, content );
-        STOP( stats.t_collect );
-
-        if( !opts.quiet ) {
-            START
-            std::unique_lock<std::mutex> lock( m );
-            printer->printPrints();
-            STOP( stats.t_print );
+        // printers keep the prints of one file only, so each path is collected and printed in turn
+        for( size_t i = 0; i <= aliases.size(); ++i ) {
+            printPath( i ? aliases[i - 1] : path, content, matches );
         }
     }
 }
+
+void Searcher::printPath( const sys_string& path, const std::string_view& content, const std::vector<search::Match>& matches,
+                          const size_t skippedLines ) {
+    STOPWATCH
+    static thread_local std::unique_ptr<Printer> printer( makePrinter() );
+
+    START
+    printer->skippedLines = skippedLines;
+    printer->collectPrints( path, matches, content );
+    STOP( stats.t_collect );
+
+    if( !opts.quiet ) {
+        START
+        std::unique_lock<std::mutex> lock( m );
+        printer->printPrints();
+        STOP( stats.t_print );
+    }
+}
@@ -10,6 +10,9 @@ namespace rx = boost;
 #include "types.hpp"
 #include "stopwatch.hpp"
 #include "searchoptions.hpp"
+#include "gitobjects.hpp"
+#include "filter.hpp"
+#include "dedup.hpp"
 
 struct Printer;
 
@@ -17,7 +20,13 @@ struct Stats {
     std::atomic_size_t matches = {0};
     std::atomic_size_t filesSearched = {0};
     std::atomic_size_t filesMatched = {0};
+    std::atomic_size_t filesBinary = {0};
+    std::atomic_size_t filesTranscoded = {0};
+    std::atomic_size_t filesArchived = {0}; // members of tar and zip archives
+    std::atomic_size_t filesDeduplicated = {0}; // files with the same blob with --rev or content with --dedup as another file, or reached through another link with -L
+    std::atomic_size_t filesUncached = {0}; // files, which were not in the page cache with --cached-first
     std::atomic_size_t bytesRead = {0};
+    std::atomic_size_t bytesHuge = {0}; // bytes read into huge page buffers
 
     std::atomic_llong t_recurse = {0}; // time to recurse directory
     std::atomic_llong t_read = {0};    // time to read files
@@ -31,6 +40,12 @@ struct Searcher {
     std::string term;
     rx::regex regex;
     SearchOptions opts;
+    utils::ReadOptions readOptions;
+    filter::FilterPtr filter; // nullptr without -g, -t and -T
+    bool inodeOrder = false;  // read the files of each batch by inode, see SearchOptions::order
+    dedup::Index duplicates;  // results of the searched contents with --dedup
+    //! decompressed outputs above this size are searched in chunks, so they need not fit into memory
+    static constexpr size_t chunkSize = 64_MB;
     std::function<Printer*()> makePrinter;
     Stats stats;
     Color gray = Color::Gray;
@@ -45,6 +60,14 @@ struct Searcher {
             gray = Color::Neutral;
         }
 
+        utils::Buffer::useHugeTLB = opts.hugeTLB;
+        utils::Links::follow = opts.followLinks;
+        readOptions.decompress = opts.decompress;
+        readOptions.archives = opts.archives;
+        readOptions.binary = opts.binary;
+        filter = filter::compile( opts.globs, opts.types, opts.notTypes, opts.path.native() );
+        inodeOrder = opts.order == "inode" || ( opts.order == "auto" && utils::isRotational( opts.path.native() ) );
+
         // use regex only for complex searches
         if( opts.isRegex ) {
             rx::regex::flag_type flags = rx::regex::normal;
@@ -64,18 +87,82 @@ struct Searcher {
 
     void onAllFiles();
     void onGitFiles();
+    //! searches the blobs of the tree of opts.rev, each blob once
+    void onRevFiles();
+
+    //! \returns check of the filter for the walkers, whether to list a directory, or nullptr without filter
+    std::function<bool( const sys_string& dirname )> descend() const;
+
+    //! searches tracked files from the index and untracked files from a walk of the repo in root,
+    //! and each nested repo or submodule found by the walk in its own job on walkers
+    //! \param strip size of the prefix of root, which is not printed
+    //! \param nested false for the main repo
+    template<class Pool, class Walkers>
+    void searchRepo( Pool& pool, Walkers& walkers, const sys_string& root, const size_t strip, const bool nested );
 
+    //! searches the files in root, and with git handling the repos in it with searchRepo
+    template<class Pool, class Walkers>
+    void searchFolder( Pool& pool, Walkers& walkers, const sys_string& root );
+
+    //! \returns term for the header, hex terms as given
+    std::string displayTerm() const { return opts.hex.empty() ? opts.term : opts.hex; }
     void printHeader();
     void printGitHeader();
+    void printRevHeader();
     void printStats();
     void printFooter( const StopWatch::ns_type& ms );
 
-    void search( const sys_string& path );
-
+    //! \param sizeHint expected size of the file, or 0
+    void search( const sys_string& path, const size_t sizeHint = 0 );
+    //! reads the file at path for search, unless it was searched before through another link or as a hardlink without matches
+    //! \param dev, ino of the file with --dedup, else 0
+    //! \param buffer to read into, leaving decompression and transcoding to searchView, or nullptr for a thread local one
+    //! \returns false, if there is nothing to search
+    bool read( const sys_string& path, const size_t sizeHint, utils::FileView& view, uint64_t& dev, uint64_t& ino,
+               utils::Buffer* buffer = nullptr );
+    //! the first half of read
+    //! \returns false, if the file at path was searched before through another link or is a hardlink without matches
+    bool visit( const sys_string& path, uint64_t& dev, uint64_t& ino );
+    //! the second half of read, for files, which were visited
+    //! \param nowait returns false with view.uncached instead of waiting for the disk, see utils::ReadOptions::nowait
+    bool fetch( const sys_string& path, const size_t sizeHint, utils::FileView& view, utils::Buffer* buffer, const bool nowait = false );
+    //! searches view of the file at path from read, possibly on another thread, if it was read into a buffer
+    void searchView( const sys_string& path, utils::FileView& view, const uint64_t dev, const uint64_t ino );
+    //! searches a gzip or zstd compressed file while decompressing it, large outputs in chunks of chunkSize
+    //! \param dev, ino of the file with --dedup, else 0
+    void searchCompressed( const sys_string& path, const std::string_view& compressed, const uint64_t dev, const uint64_t ino );
+    //! searches each member of an archive like a file named path!member
+    void searchArchive( const sys_string& path, const std::string_view& content );
+    //! searches a blob of the repo, which is shared by all paths
+    void searchBlob( const gitobjects::Repo& repo, const gitobjects::Oid& oid, const std::vector<sys_string>& paths );
+    //! classifies and transcodes content, which was not read by utils::fromFileP, and searches it
+    void searchMemory( const sys_string& path, const std::string_view& content, const std::vector<sys_string>& aliases = {} );
+    //! searches content and prints matches with path
+    //! \param aliases more paths with the same content, which get the same matches
+    void searchContent( const sys_string& path, const std::string_view& content, const std::vector<sys_string>& aliases = {} );
+    //! like searchContent, but reuses the matches of an earlier file with the same content
+    //! \param dev device and inode of the file, both 0 if unknown
+    void searchUnique( const sys_string& path, const std::string_view& content, const uint64_t dev, const uint64_t ino );
+    //! \returns matches of term in content
+    //! \param binary is set to true, if content turns out to be binary
+    std::vector<search::Match> findMatches( const std::string_view& content, bool& binary );
+    //! prints matches with path and each alias, counts binaries
+    void printMatches( const sys_string& path, const std::string_view& content, const std::vector<search::Match>& matches,
+                       const bool binary, const std::vector<sys_string>& aliases = {} );
+    //! prints matches with path only, without counting them
+    //! \param skippedLines lines of the file before content, if it is searched in chunks
+    void printPath( const sys_string& path, const std::string_view& content, const std::vector<search::Match>& matches,
+                    const size_t skippedLines = 0 );
+
+    //! \returns true, if content has a \0 behind the block checked by encoding::classify
+    static bool hasLateNul( const std::string_view& content );
     //! search with strcasestr
     std::vector<search::Match> caseInsensitiveSearch( const std::string_view& content );
     //! search with strstr
-    std::vector<search::Match> caseSensitiveSearch( const std::string_view& content );
+    //! \param binary is set to true, if content has a \0 behind the first block
+    std::vector<search::Match> caseSensitiveSearch( const std::string_view& content, bool& binary );
+    //! search in binaries, which may contain \0, as may the term
+    std::vector<search::Match> binarySearch( const std::string_view& content );
     //! search with boost::regex
     std::vector<search::Match> regexSearch( const std::string_view& content );
 };
@@ -1,9 +1,34 @@
 #include "searchoptions.hpp"
+#include "filter.hpp"
 
 #include "boost/program_options.hpp"
 #include "boost/algorithm/string/replace.hpp"
 namespace po = boost::program_options;
 
+//! parses hex bytes like "DE AD BE EF" or "deadbeef" into bytes
+//! \returns false, if hex has odd digits or other chars than hex digits and whitespace
+bool parseHex( const std::string& hex, std::string& bytes ) {
+    std::string digits;
+
+    for( char c : hex ) {
+        if( isxdigit( static_cast<unsigned char>( c ) ) ) {
+            digits.push_back( c );
+        } else if( !isspace( static_cast<unsigned char>( c ) ) ) {
+            return false;
+        }
+    }
+
+    if( digits.size() % 2 ) { return false; }
+
+    bytes.clear();
+
+    for( size_t i = 0; i < digits.size(); i += 2 ) {
+        bytes.push_back( static_cast<char>( std::stoi( digits.substr( i, 2 ), nullptr, 16 ) ) );
+    }
+
+    return true;
+}
+
 void usage( const std::string& description ) {
     LOG( "Usage  : fsrc [options] term" );
     LOG( description );
@@ -21,16 +46,36 @@ SearchOptions SearchOptions::parseArgs( int argc, char* argv[] ) {
     ( "dir,d", po::value<std::string>(), "Search folder" )
     ( "ignore-case,i", "Case insensitive search" )
     ( "regex,r", "Regex search (slower)" )
-    ( "no-git", "Disable search with 'git ls-files'" )
+    ( "search-zip,z", "Search in gzip and zstd compressed files" )
+    ( "archives", "Search in tar and zip archives" )
+    ( "binary", "Search in binaries, print byte offsets with hexdump" )
+    ( "hex", po::value<std::string>(), "Search hex bytes like \"DE AD BE EF\", implies --binary" )
+    ( "rev", po::value<std::string>(), "Search a commit, branch or tag of the git repo instead of the files" )
+    ( "changed", "Search only files changed or added since HEAD, staged or not" )
+    ( "changed-since", po::value<std::string>(), "Search only files changed or added since a commit, branch or tag" )
+    ( "glob,g", po::value<std::vector<std::string>>(), "Search only files matching the glob, skip them with !glob, repeatable" )
+    ( "type,t", po::value<std::vector<std::string>>(), "Search only files of this type like cpp, repeatable" )
+    ( "type-not,T", po::value<std::vector<std::string>>(), "Skip files of this type, repeatable" )
+    ( "type-list", "Print the file types with their globs" )
+    ( "follow,L", "Follow symlinks, search each file once" )
+    ( "dedup", "Search files with the same content once, print their matches for each path" )
+    ( "threads,j", po::value<size_t>(), "Search with N threads, by default one per usable CPU and more while reading from disk" )
+    ( "pipeline", "Read and search files in separate stages, for network filesystems" )
+    ( "io-threads", po::value<size_t>(), "Read with N threads in the pipeline, implies --pipeline without --cached-first" )
+    ( "cached-first", "Search files in the page cache first and read the others in the background, for first results without waiting for the disk" )
+    ( "order", po::value<std::string>(), "Read the files of each batch in walk or inode order, by default inode order on spinning disks" )
+    ( "pin", "Pin the search threads to the CPUs, spread over the NUMA nodes, so their buffers stay on the local node" )
+    ( "no-git", "Disable .gitignore and git repo handling" )
     ( "no-colors", "Disable colorized output" )
     ( "no-piped", "Disable piped output" )
     ( "html", "open web page with results" )
     ( "quiet,q", "only print status" )
+    ( "hugetlb", "read large files into buffers from the hugetlbfs pool" )
     ;
 
     po::options_description hidden( "Hidden options" );
     hidden.add_options()
-    ( "term,t", po::value<std::string>()->required(), "Search term" );
+    ( "term", po::value<std::string>()->required(), "Search term" );
 
     po::positional_options_description last;
     last.add( "term", -1 );
@@ -79,6 +124,93 @@ SearchOptions SearchOptions::parseArgs( int argc, char* argv[] ) {
         opts.path = utils::absolutePath();
     }
 
+    // search a git revision from the object database
+    if( args.count( "rev" ) ) {
+        opts.rev = args["rev"].as<std::string>();
+    }
+
+    // search changed files only
+    if( args.count( "changed" ) ) {
+        opts.changedSince = "HEAD";
+    }
+
+    if( args.count( "changed-since" ) ) {
+        opts.changedSince = args["changed-since"].as<std::string>();
+    }
+
+    // print file types for -t and -T
+    if( args.count( "type-list" ) ) {
+        std::cout << filter::typeList();
+        exit( EXIT_SUCCESS );
+    }
+
+    // filter files by globs and types
+    if( args.count( "glob" ) ) {
+        opts.globs = args["glob"].as<std::vector<std::string>>();
+    }
+
+    if( args.count( "type" ) ) {
+        opts.types = args["type"].as<std::vector<std::string>>();
+    }
+
+    if( args.count( "type-not" ) ) {
+        opts.notTypes = args["type-not"].as<std::vector<std::string>>();
+    }
+
+    for( const auto& types : { opts.types, opts.notTypes } ) {
+        for( const std::string& type : types ) {
+            if( !filter::isType( type ) ) {
+                LOG( "Error  : unknown file type \"" << type << "\", see --type-list" );
+                return opts;
+            }
+        }
+    }
+
+    // follow symlinks
+    if( args.count( "follow" ) ) {
+        opts.followLinks = true;
+    }
+
+    // search identical files once
+    if( args.count( "dedup" ) ) {
+        opts.dedup = true;
+    }
+
+    // fixed number of workers, 0 keeps the automatic one
+    if( args.count( "threads" ) ) {
+        opts.threads = args["threads"].as<size_t>();
+    }
+
+    // separate read and search stages
+    if( args.count( "pipeline" ) ) {
+        opts.pipeline = true;
+    }
+
+    // files, which are not in the page cache, are read by a pool of their own, but not in stages
+    if( args.count( "cached-first" ) ) {
+        opts.cachedFirst = true;
+    }
+
+    if( args.count( "io-threads" ) ) {
+        opts.pipeline |= !opts.cachedFirst;
+        opts.ioThreads = args["io-threads"].as<size_t>();
+    }
+
+    // sorted reads seek less on spinning disks
+    if( args.count( "order" ) ) {
+        opts.order = args["order"].as<std::string>();
+
+        if( opts.order != "auto" && opts.order != "walk" && opts.order != "inode" ) {
+            LOG( "Error  : unknown order \"" << opts.order << "\", use walk, inode or auto" );
+            return opts;
+        }
+    }
+
+    // workers bound to CPUs
+    if( args.count( "pin" ) ) {
+        opts.pin = true;
+    }
+
     // disable ls-files
     if( args.count( "no-git" ) ) {
         opts.noGit = true;
@@ -104,6 +236,26 @@ SearchOptions SearchOptions::parseArgs( int argc, char* argv[] ) {
         opts.html = true;
     }
 
+    // use explicit huge pages for large buffers
+    if( args.count( "hugetlb" ) ) {
+        opts.hugeTLB = true;
+    }
+
+    // decompress gzip and zstd files
+    if( args.count( "search-zip" ) ) {
+        opts.decompress = true;
+    }
+
+    // search members of tar and zip files
+    if( args.count( "archives" ) ) {
+        opts.archives = true;
+    }
+
+    // search binaries, too
+    if( args.count( "binary" ) ) {
+        opts.binary = true;
+    }
+
     // ignore case
     if( args.count( "ignore-case" ) ) {
         opts.ignoreCase = true;
@@ -115,7 +267,19 @@ SearchOptions SearchOptions::parseArgs( int argc, char* argv[] ) {
     }
 
     // term
-    if( args.count( "term" ) ) {
+    if( args.count( "hex" ) ) {
+        opts.hex = args["hex"].as<std::string>();
+        opts.binary = true;
+        opts.isRegex = false;
+        opts.ignoreCase = false;
+
+        if( !parseHex( opts.hex, opts.term ) ) {
+            LOG( "Error  : invalid hex bytes \"" << opts.hex << "\"" );
+            opts.term.clear();
+        }
+
+        opts.success = !opts.term.empty() && !args.count( "term" );
+    } else if( args.count( "term" ) ) {
         opts.term = args["term"].as<std::string>();
         opts.success = !opts.term.empty();
     } else {
@@ -10,7 +10,25 @@ struct SearchOptions {
     bool isRegex = false;
     bool quiet = false;
     bool html = false;
+    bool hugeTLB = false;
+    bool decompress = false;
+    bool archives = false;
+    bool binary = false;
+    bool followLinks = false;
+    bool dedup = false;
+    size_t threads = 0; // workers of -j, 0 for one per usable CPU, adapted to the time spent reading
+    bool pipeline = false; // read and search files in separate stages
+    size_t ioThreads = 0; // readers of the pipeline or of --cached-first, 0 for automatic
+    bool cachedFirst = false; // search files in the page cache right away, read the others in the background
+    std::string order = "auto"; // of the reads in each batch, walk, inode, or auto for inode order on spinning disks
+    bool pin = false; // bind the workers to the CPUs, see utils::cpuOrder
     std::string term;
+    std::string hex; // term as given with --hex
+    std::string rev; // commit, branch or tag to search with --rev instead of the worktree
+    std::string changedSince; // search only files changed relative to this revision, HEAD with --changed
+    std::vector<std::string> globs; // include globs of -g, excluding with a leading !
+    std::vector<std::string> types; // file types of -t
+    std::vector<std::string> notTypes; // file types of -T
     fs::path path;
     sys_string prefix;
     bool piped = pipes::stdoutIsPipe();
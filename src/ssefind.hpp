@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstring>
+#include <algorithm>
 #include <vector>
 #include <emmintrin.h>
 
@@ -10,10 +11,25 @@
 #define SSE128 16
 
 namespace sse {
-inline std::vector<search::Match> find( const std::string_view& text, const std::string& term ) {
+//! \param binary if set, the search stops at the first \0 from offset skip on and sets it to true
+inline std::vector<search::Match> find( const std::string_view& text, const std::string& term, bool* binary = nullptr, const size_t skip = 0 ) {
     std::vector<search::Match> matches;
     const char* start = text.data();
 
+    if( text.size() < term.size() ) { return matches; }
+
+    // nothing to check behind skip
+    if( binary && skip >= text.size() ) { binary = nullptr; }
+
+    // memchr is fast enough for single chars
+    if( binary && term.size() == 1 ) {
+        *binary = memchr( start + skip, '\0', text.size() - skip ) != nullptr;
+
+        if( *binary ) { return matches; }
+
+        binary = nullptr;
+    }
+
     if( term.size() == 1 ) {
         const char* pos = text.data();
 
@@ -31,13 +47,31 @@ inline std::vector<search::Match> find( const std::string_view& text, const std:
     static const __m128i lastOne = _mm_setr_epi8( 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff );
     const __m128i first  = _mm_set1_epi8( term[0] );
     const __m128i second = _mm_set1_epi8( term[1] );
+    const __m128i zero   = _mm_setzero_si128();
 
     size_t blocks = ( text.size() - term.size() ) / SSE128 + 1;
+    const char* last = start + text.size() - term.size(); // last possible match, terms with \0 could match the padding
+    size_t checked = blocks * SSE128; // bytes checked for \0 within the loop
     int diff = 0;
 
     for( size_t block = 0; block < blocks; ++block ) {
         // load 16 bytes of text
         const __m128i text16  = _mm_load_si128( ( __m128i const* )( start + block * SSE128 ) );
+
+        // check for \0 in the same pass, but not in the padding behind text
+        if( binary && block * SSE128 + SSE128 > skip ) {
+            int zeros = _mm_movemask_epi8( _mm_cmpeq_epi8( text16, zero ) );
+            const size_t offset = block * SSE128;
+
+            if( offset + SSE128 > text.size() ) { zeros &= ( 1 << ( text.size() - offset ) ) - 1; }
+
+            if( offset < skip ) { zeros &= ~( ( 1 << ( skip - offset ) ) - 1 ); }
+
+            if( zeros ) {
+                *binary = true;
+                return matches;
+            }
+        }
         // compare text with first char
         const __m128i comp1   = _mm_cmpeq_epi8( text16, first );
         // compare text with 2nd char...
@@ -46,6 +80,7 @@ inline std::vector<search::Match> find( const std::string_view& text, const std:
         __m128i shift  = _mm_srli_si128( comp2, 1 );
 
         // set last byte to ff, checking is faster than branching
+        // so the memcmp below starts at the second char
         shift = _mm_or_si128( shift, lastOne );
 
         // if both have hits
@@ -57,7 +92,7 @@ inline std::vector<search::Match> find( const std::string_view& text, const std:
         while( ( diff = ffs( mv2 ) ) ) {
             const char* pos = start + block * SSE128 + diff - 1;
 
-            if( !memcmp( pos + 2, &term[2], term.size() - 2 ) ) {
+            if( pos <= last && !memcmp( pos + 1, &term[1], term.size() - 1 ) ) {
                 auto iter = text.cbegin() + ( pos - start );
                 matches.emplace_back( iter, iter + term.size() );
             }
@@ -66,6 +101,12 @@ inline std::vector<search::Match> find( const std::string_view& text, const std:
         }
     }
 
+    // check the rest, which was too short for the term
+    if( binary && checked < text.size() ) {
+        const size_t from = std::max( checked, skip );
+        *binary = from < text.size() && memchr( start + from, '\0', text.size() - from ) != nullptr;
+    }
+
     return matches;
 }
 }
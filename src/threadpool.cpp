@@ -1,37 +1,146 @@
 #include <chrono>
+#include <climits>
+#include <algorithm>
 
 #include "threadpool.hpp"
 
-// heavily influenced by
-// https://github.com/progschj/ThreadPool
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
 
-ThreadPool::ThreadPool( size_t threads ) : threads( threads ), jobs( 0 ) {}
+// work stealing deque after
+// Lê, Pop, Cohen, Zappa Nardelli: Correct and Efficient Work-Stealing for Weak Memory Models
 
-ThreadPool::~ThreadPool() {
-    join();
+namespace {
+// pool and deque of the calling worker, so jobs added by workers go to their own deque
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+// idle workers look for jobs this often, before they park
+constexpr int spins = 16;
+
+//! finished jobs of this thread for its next adds, beyond max they are deleted
+struct Spares {
+    static constexpr size_t max = 1024;
+    std::vector<ThreadPool::Job*> jobs;
+
+    ~Spares() {
+        for( ThreadPool::Job* job : jobs ) { delete job; }
+    }
+};
+
+thread_local Spares spares;
 }
 
-void ThreadPool::workOff() {
-    Job* job = nullptr;
+ThreadPool::Deque::Array::Array( int64_t capacity ) :
+    capacity( capacity ),
+    slots( new std::atomic<Job*>[capacity] ) {}
 
-    if( jobs.pop( job ) && job && *job ) {
-        ( *job )();
-        // decrement _after_ job is done
-        count--;
-        delete job;
+ThreadPool::Deque::Deque() {
+    arrays.emplace_back( new Array( 1024 ) );
+    array.store( arrays.back().get(), std::memory_order_relaxed );
+}
+
+void ThreadPool::Deque::push( Job* job ) {
+    const int64_t b = bottom.load( std::memory_order_relaxed );
+    const int64_t t = top.load( std::memory_order_acquire );
+    Array* a = array.load( std::memory_order_relaxed );
+
+    // full, the old array stays readable for thieves
+    if( b - t > a->capacity - 1 ) {
+        Array* grown = new Array( a->capacity * 2 );
+
+        for( int64_t i = t; i < b; ++i ) { grown->put( i, a->get( i ) ); }
+
+        arrays.emplace_back( grown );
+        array.store( grown, std::memory_order_release );
+        a = grown;
     }
+
+    a->put( b, job );
+    bottom.store( b + 1, std::memory_order_release );
 }
 
-bool ThreadPool::add( const Job& job ) {
+ThreadPool::Job* ThreadPool::Deque::pop() {
+    const int64_t b = bottom.load( std::memory_order_relaxed ) - 1;
+    Array* a = array.load( std::memory_order_relaxed );
+    bottom.store( b, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    int64_t t = top.load( std::memory_order_relaxed );
+
+    if( t > b ) {
+        bottom.store( b + 1, std::memory_order_relaxed );
+        return nullptr;
+    }
+
+    Job* job = a->get( b );
+
+    // last job, race against the thieves
+    if( t == b ) {
+        if( !top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+            job = nullptr;
+        }
+
+        bottom.store( b + 1, std::memory_order_relaxed );
+    }
+
+    return job;
+}
+
+ThreadPool::Job* ThreadPool::Deque::steal() {
+    int64_t t = top.load( std::memory_order_acquire );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    const int64_t b = bottom.load( std::memory_order_acquire );
+
+    if( t >= b ) { return nullptr; }
+
+    Job* job = array.load( std::memory_order_acquire )->get( t );
+
+    if( !top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+        return nullptr;
+    }
+
+    return job;
+}
+
+ThreadPool::ThreadPool( size_t threads ) : threads( std::max<size_t>( threads, 1 ) ), injected( 0 ), allowed( static_cast<uint32_t>( this->threads ) ) {}
+
+ThreadPool::~ThreadPool() {
+    join();
+}
+
+ThreadPool::Job* ThreadPool::spare() {
     std::call_once( initialized, [this] { this->initialize(); } );
-    jobs.push( new Job( job ) );
+
+    if( spares.jobs.empty() ) { return new Job; }
+
+    Job* job = spares.jobs.back();
+    spares.jobs.pop_back();
+    return job;
+}
+
+void ThreadPool::submit( Job* job ) {
+    // increment _before_ the job is visible, so count is 0 only, when all are done
     count++;
-    return true;
+
+    if( currentPool == this ) {
+        deques[currentIndex]->push( job );
+    } else {
+        injected.push( job );
+    }
+
+    wake( 1 );
 }
 
 void ThreadPool::join() {
     if( running ) {
         running = false;
+        resize();
+        wake( static_cast<int>( workers.size() ) );
 
         for( std::thread& worker : workers ) {
             worker.join();
@@ -39,22 +148,176 @@ void ThreadPool::join() {
     }
 }
 
+void ThreadPool::limit( size_t active ) {
+    active = std::clamp<size_t>( active, 1, threads );
+
+    if( allowed.exchange( static_cast<uint32_t>( active ) ) < active ) { resize(); }
+}
+
+void ThreadPool::resize() {
+    resized.fetch_add( 1, std::memory_order_seq_cst );
+#ifdef __linux__
+    syscall( SYS_futex, reinterpret_cast<uint32_t*>( &resized ), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0 );
+#else
+    { std::unique_lock<std::mutex> lock( parking ); }
+
+    parked.notify_all();
+#endif
+}
+
 void ThreadPool::initialize() {
-    while( threads-- ) {
-        workers.reserve( threads );
-        workers.emplace_back( [this] {
-            for( ;; ) {
-
-                if( count ) {
-                    this->workOff();
-                } else {
-                    std::this_thread::sleep_for( std::chrono::microseconds( 1 ) );
-                }
-
-                if( !( running || count ) ) {
-                    break;
-                }
-            }
-        } );
+    workers.reserve( threads );
+    deques.reserve( threads );
+
+    for( size_t i = 0; i < threads; ++i ) {
+        deques.emplace_back( new Deque() );
+    }
+
+    for( size_t i = 0; i < threads; ++i ) {
+        workers.emplace_back( [this, i] { this->work( i ); } );
+    }
+}
+
+void ThreadPool::work( const size_t index ) {
+    currentPool = this;
+    currentIndex = index;
+
+#ifdef __linux__
+
+    if( !cores.empty() ) {
+        cpu_set_t set;
+        CPU_ZERO( &set );
+        CPU_SET( cores[index % cores.size()], &set );
+        pthread_setaffinity_np( pthread_self(), sizeof( set ), &set );
+    }
+
+#endif
+
+    for( ;; ) {
+        // inactive workers leave their jobs to the thieves, and pass on a wake up, which may have been meant for a job
+        if( index >= allowed.load( std::memory_order_relaxed ) ) {
+            wake( 1 );
+
+            if( !running ) { break; }
+
+            retire( index );
+            continue;
+        }
+
+        Job* job = nullptr;
+        searching++;
+
+        for( int spin = 0; spin < spins && !( job = find( index ) ); ++spin ) {
+            std::this_thread::yield();
+        }
+
+        // the last searcher, which found a job, wakes another one for the jobs behind it
+        if( searching.fetch_sub( 1, std::memory_order_seq_cst ) == 1 && job ) { wake( 1 ); }
+
+        if( job ) {
+            run( job );
+            continue;
+        }
+
+        // announce parking, then look again, so a job added in between is not missed
+        const uint32_t seen = epoch.load( std::memory_order_seq_cst );
+        sleepers.fetch_add( 1, std::memory_order_seq_cst );
+
+        if( ( job = find( index ) ) ) {
+            sleepers--;
+            run( job );
+            continue;
+        }
+
+        if( !( running || count ) ) {
+            sleepers--;
+            break;
+        }
+
+        park( seen );
+        sleepers--;
+    }
+
+    currentPool = nullptr;
+}
+
+ThreadPool::Job* ThreadPool::find( const size_t index ) {
+    if( Job* job = deques[index]->pop() ) { return job; }
+
+    Job* job = nullptr;
+
+    if( injected.pop( job ) ) { return job; }
+
+    // start at a random victim, so thieves spread over the deques
+    static thread_local uint32_t seed = static_cast<uint32_t>( index ) * 2654435761u + 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    for( size_t i = 0; i < threads; ++i ) {
+        const size_t victim = ( seed + i ) % threads;
+
+        if( victim == index ) { continue; }
+
+        if( ( job = deques[victim]->steal() ) ) { return job; }
+    }
+
+    return nullptr;
+}
+
+void ThreadPool::run( Job* job ) {
+    job->run();
+
+    if( spares.jobs.size() < Spares::max ) {
+        spares.jobs.push_back( job );
+    } else {
+        delete job;
+    }
+
+    // decrement _after_ job is done, the last one wakes the parked workers for exit
+    if( count.fetch_sub( 1 ) == 1 && !running ) {
+        wake( static_cast<int>( threads ) );
+    }
+}
+
+void ThreadPool::wake( const int waiters ) {
+    // pairs with the fetch_sub on searching and the fetch_add on sleepers in work
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+
+    // a searching worker finds the job without a syscall, unless the pool is joined
+    if( waiters == 1 && searching.load( std::memory_order_seq_cst ) ) { return; }
+
+    if( !sleepers.load( std::memory_order_seq_cst ) ) { return; }
+
+    epoch.fetch_add( 1, std::memory_order_seq_cst );
+#ifdef __linux__
+    syscall( SYS_futex, reinterpret_cast<uint32_t*>( &epoch ), FUTEX_WAKE_PRIVATE, waiters, nullptr, nullptr, 0 );
+#else
+    { std::unique_lock<std::mutex> lock( parking ); }
+
+    // retired workers wait on the same condition, so notify_one might miss the parked ones
+    parked.notify_all();
+#endif
+}
+
+void ThreadPool::park( const uint32_t seen ) {
+#ifdef __linux__
+    static_assert( sizeof( std::atomic<uint32_t> ) == sizeof( uint32_t ), "futex needs a plain 32 bit word" );
+    syscall( SYS_futex, reinterpret_cast<uint32_t*>( &epoch ), FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0 );
+#else
+    std::unique_lock<std::mutex> lock( parking );
+    parked.wait( lock, [this, seen] { return epoch.load() != seen; } );
+#endif
+}
+
+void ThreadPool::retire( const size_t index ) {
+    // read resized first, so a limit or join in between is not missed
+    for( uint32_t seen = resized.load(); index >= allowed.load() && running; seen = resized.load() ) {
+#ifdef __linux__
+        syscall( SYS_futex, reinterpret_cast<uint32_t*>( &resized ), FUTEX_WAIT_PRIVATE, seen, nullptr, nullptr, 0 );
+#else
+        std::unique_lock<std::mutex> lock( parking );
+        parked.wait( lock, [this, seen] { return resized.load() != seen; } );
+#endif
     }
 }
@@ -6,6 +6,10 @@
 #include <atomic>
 #include <functional>
 #include <future>
+#include <memory>
+#include <condition_variable>
+#include <new>
+#include <type_traits>
 
 #define NO_THREADPOOL    0
 #define OWN_THREADPOOL   1
@@ -19,8 +23,10 @@
 #endif // BOOST_THREADPOOL
 
 
+// POOL( threads ) declares pool with up to threads workers
+
 #if THREADPOOL == NO_THREADPOOL
-#define POOL struct { \
+#define POOL( threads ) struct { \
     void add( const std::function<void()>& f ) { \
         f(); \
     } \
@@ -28,18 +34,18 @@
 #endif // NO_THREADPOOL
 
 #if THREADPOOL == BOOST_THREADPOOL
-#define POOL struct ThreadPool { \
-    boost::asio::thread_pool mPool{ std::min<size_t>( std::thread::hardware_concurrency(), 8u ) }; \
+#define POOL( threads ) struct ThreadPool { \
+    boost::asio::thread_pool mPool; \
     void add( const std::function<void()>& f ) { \
         boost::asio::post( mPool, f ); \
     } \
-    ThreadPool() {} \
+    ThreadPool( size_t n ) : mPool( n ) {} \
     ~ThreadPool() { mPool.join(); } \
-} pool;
+} pool( threads );
 #endif // BOOST_THREADPOOL
 
 #if THREADPOOL == ASYNC_THREADPOOL
-#define POOL struct ThreadPool { \
+#define POOL( threads ) struct ThreadPool { \
     std::vector<std::future<void>> results; \
     void add( const std::function<void()>& f ) { \
         results.emplace_back( std::async( std::launch::async, f ) ); \
@@ -49,30 +55,133 @@
 #endif // BOOST_THREADPOOL
 
 #if THREADPOOL == OWN_THREADPOOL
-// max 8 threads, else start/stop needs longer than the actual work
-#define POOL ThreadPool pool( std::min<size_t>( std::thread::hardware_concurrency(), 8u ) );
+#define POOL( threads ) ThreadPool pool( threads );
 #endif // OWN_THREADPOOL
 
-//! busy waiting lockfree threadpool
-//! fast, if you keep the queue filled with jobs
+//! work stealing threadpool
+//! each worker pushes and pops the jobs it adds at the bottom of its own deque, idle workers steal from the top
+//! of the others, jobs from other threads are injected through a shared queue. Workers without work park on a futex.
+//! Only the first active() workers take jobs, the others stay parked, until limit raises active.
 class ThreadPool {
     public:
-        typedef std::function<void()> Job;
+        //! job with its state stored inline, recycled by the worker, which ran it, so the jobs, which the workers add,
+        //! allocate nothing in the long run
+        class Job {
+            public:
+                //! stores job, states larger than the buffer, like lambdas with many captures, are kept on the heap
+                template<class F>
+                void set( F&& job ) {
+                    using State = std::decay_t<F>;
+
+                    if constexpr( sizeof( State ) <= sizeof( state ) && alignof( State ) <= alignof( std::max_align_t ) ) {
+                        new( state ) State( std::forward<F>( job ) );
+                        call = []( Job & self ) {
+                            State* stored = std::launder( reinterpret_cast<State*>( self.state ) );
+                            ( *stored )();
+                            stored->~State();
+                        };
+                    } else {
+                        set( [stored = std::make_unique<State>( std::forward<F>( job ) )] { ( *stored )(); } );
+                    }
+                }
+
+                //! runs the job and destroys its state
+                void run() { call( *this ); }
+
+            private:
+                alignas( std::max_align_t ) unsigned char state[48];
+                void ( *call )( Job& self ) = nullptr;
+        };
+
         ThreadPool( size_t threads );
         ~ThreadPool();
-        bool add( const Job& job );
+
+        template<class F>
+        bool add( F&& job ) {
+            Job* recycled = spare();
+            recycled->set( std::forward<F>( job ) );
+            submit( recycled );
+            return true;
+        }
+
         void join();
+
+        //! \returns number of workers
+        size_t size() const { return threads; }
+        //! \returns number of workers, which take jobs
+        size_t active() const { return allowed.load( std::memory_order_relaxed ); }
+        //! lets the first active workers take jobs, between 1 and size, the others park after their current job
+        //! \note keeps working after join, which lets the inactive workers exit and the active ones finish the jobs
+        void limit( size_t active );
+        //! binds worker i to cpus[i % cpus.size()], before it runs its first job, so the memory it touches first,
+        //! like its thread local buffers, is placed on the NUMA node of its CPU, Linux only
+        //! \note call before the first add, an empty cpus leaves the workers to the scheduler
+        void pin( const std::vector<int>& cpus ) { cores = cpus; }
+
+        //! Chase-Lev deque, push and pop by the owning worker only, steal by all
+        //! \note grown arrays are kept until destruction, as thieves may still read them
+        class Deque {
+            public:
+                Deque();
+                void push( Job* job );
+                //! \returns last pushed job or nullptr
+                Job* pop();
+                //! \returns first pushed job, nullptr if empty or lost to another thief
+                Job* steal();
+            private:
+                struct Array {
+                    explicit Array( int64_t capacity );
+                    int64_t capacity;
+                    std::unique_ptr<std::atomic<Job*>[]> slots;
+                    Job* get( int64_t i ) const { return slots[i & ( capacity - 1 )].load( std::memory_order_relaxed ); }
+                    void put( int64_t i, Job* job ) { slots[i & ( capacity - 1 )].store( job, std::memory_order_relaxed ); }
+                };
+
+                alignas( 64 ) std::atomic<int64_t> top = {0};
+                alignas( 64 ) std::atomic<int64_t> bottom = {0};
+                std::atomic<Array*> array;
+                std::vector<std::unique_ptr<Array>> arrays;
+        };
+
     private:
         void initialize();
-        void workOff();
+        //! \returns a job run earlier by this thread, or a new one
+        Job* spare();
+        //! queues job with its state set
+        void submit( Job* job );
+        void work( const size_t index );
+        //! \returns a job from the own deque, the injected queue or another worker, or nullptr
+        Job* find( const size_t index );
+        //! runs job and keeps it as spare for the next add
+        void run( Job* job );
+        //! wakes up to waiters parked workers, if any
+        void wake( const int waiters );
+        //! parks the calling worker, until wake is called after seen was read from epoch
+        void park( const uint32_t seen );
+        //! parks the calling worker, while active is below or at index and the pool is running
+        void retire( const size_t index );
+        //! wakes the retired workers to check active again
+        void resize();
 
         size_t threads = 4;
+        std::vector<int> cores; // of pin
         std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<Deque>> deques;
+
+        boost::lockfree::queue<Job*> injected;
+        std::atomic_int count = {0}; // added, but not finished jobs
 
-        boost::lockfree::queue<Job*> jobs;
-        std::atomic_int count = {0};
+        // event count, a worker only parks, if no job was added since it read epoch
+        alignas( 64 ) std::atomic<uint32_t> epoch = {0};
+        std::atomic_int sleepers = {0};  // parking or parked workers
+        std::atomic_int searching = {0}; // workers looking for jobs before they park
+        alignas( 64 ) std::atomic<uint32_t> allowed; // active workers
+        std::atomic<uint32_t> resized = {0}; // changes of allowed and running, retired workers wait on it
+#ifndef __linux__
+        std::mutex parking;
+        std::condition_variable parked;
+#endif
 
         std::once_flag initialized;
         std::atomic_bool running = {true};
 };
-
@@ -1,15 +1,22 @@
 #include "utils.hpp"
 
 #include <map>
+#include <array>
+#include <mutex>
+#include <unordered_set>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <algorithm>
+#include <thread>
 #include <cstdio>
 #include <cstring>
 #include <fcntl.h>
 
 #include "pipes.hpp"
 #include "stdstr.hpp"
+#include "compression.hpp"
+#include "archive.hpp"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -25,14 +32,22 @@ const std::map<Color, WORD> winColors = {
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
+
 #define fwrite fwrite_unlocked
 #define open open64
+#define openat openat64
 #define readdir readdir64
 #define dirent dirent64
 #define stat stat64
 #define fstat fstat64
+#define fstatat fstatat64
 #endif
 
 #endif
@@ -75,87 +90,137 @@ void utils::printColor( Color color, const std::string& text ) {
     }
 }
 
-// git ls-files -zco --exclude-standard | tr '\0' '\n'
-void utils::gitLsFiles( const fs::path& path, const std::function<void( const sys_string& filename )>& callback ) {
+#if BOOST_OS_LINUX
+bool utils::Buffer::allocate( const size_t requested ) {
+    huge = false;
+    mapped = 0;
+
+    if( requested + 16 >= hugeThreshold ) {
+        // round up to full huge pages, including the 16 bytes padding
+        const size_t bytes = ( requested + 16 + hugePageSize - 1 ) & ~( hugePageSize - 1 );
+
+        // explicit hugetlbfs pool, fails if there are not enough free pages
+        if( useHugeTLB ) {
+            void* map = mmap( nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+
+            if( map != MAP_FAILED ) {
+                ptr = static_cast<char*>( map );
+                reserved = bytes - 16;
+                mapped = bytes;
+                huge = true;
+                return true;
+            }
+        }
 
-    fs::current_path( path );
+        // transparent huge pages, map one page more and cut the unaligned ends
+        void* map = mmap( nullptr, bytes + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
 
-#ifdef _WIN32
-    std::string nullDevice = "NUL";
-#else
-    std::string nullDevice = "/dev/null";
-#endif
+        if( map != MAP_FAILED ) {
+            char* begin = static_cast<char*>( map );
+            char* aligned = reinterpret_cast<char*>( ( reinterpret_cast<uintptr_t>( begin ) + hugePageSize - 1 ) & ~( hugePageSize - 1 ) );
+            char* end = begin + bytes + hugePageSize;
 
-    // -c Show cached files in the output (default)
-    // -o Show other (i.e. untracked) files in the output
-    // -z \0 line termination on output and do not quote filenames
-    const std::string command = "git ls-files -coz --exclude-standard 2> " + nullDevice;
+            if( aligned != begin ) { munmap( begin, aligned - begin ); }
 
-    const size_t size = 1_kB;
-    sys_string buffer( size, '\0' );
-    const sys_string::value_type* first = &buffer.front();
-    const sys_string::value_type* last  = &buffer.back();
-    sys_string rest;
+            if( end != aligned + bytes ) { munmap( aligned + bytes, end - ( aligned + bytes ) ); }
 
-    FILE* pipe = popen( command.c_str(), "r" );
-
-    if( !pipe ) { return; }
+            ptr = aligned;
+            reserved = bytes - 16;
+            mapped = bytes;
+            huge = 0 == madvise( ptr, mapped, MADV_HUGEPAGE );
+            return true;
+        }
+    }
 
-    while( !feof( pipe ) ) {
-#ifdef _WIN32
+    // align at 128 bits for ssestr
+    ptr = static_cast<char*>( boost::alignment::aligned_alloc( 16, requested + 16 ) );
+    reserved = ptr ? requested : 0;
+    return ptr != nullptr;
+}
 
-        if( fgetws( buffer.data(), 1_kB, pipe ) != nullptr ) {
+void utils::Buffer::release( char* ptr, const size_t mapped ) {
+    if( mapped ) {
+        munmap( ptr, mapped );
+    } else {
+        boost::alignment::aligned_free( ptr );
+    }
+}
 #else
+bool utils::Buffer::allocate( const size_t requested ) {
+    // align at 128 bits for ssestr
+    ptr = static_cast<char*>( boost::alignment::aligned_alloc( 16, requested + 16 ) );
+    reserved = ptr ? requested : 0;
+    return ptr != nullptr;
+}
 
-        if( fgets( buffer.data(), 1_kB, pipe ) != nullptr ) {
+void utils::Buffer::release( char* ptr, const size_t ) {
+    boost::alignment::aligned_free( ptr );
+}
 #endif
-            const sys_string::value_type* from = first;
 
-            // search first path
-            const sys_string::value_type* to = std::char_traits<sys_string::value_type>::find( from, size, '\0' );
+char* utils::Buffer::extend( const size_t requested ) {
+    if( reserved < requested || !ptr ) {
+        char* old = ptr;
+        const size_t oldReserved = reserved;
+        const size_t oldMapped = mapped;
+        const bool oldHuge = huge;
+
+        if( !allocate( requested ) ) {
+            ptr = old;
+            reserved = oldReserved;
+            mapped = oldMapped;
+            huge = oldHuge;
+            return nullptr;
+        }
+
+        if( old ) { memcpy( ptr, old, size ); }
 
-            if( !to ) { goto end; }
+        release( old, oldMapped );
+    }
 
-            // and prepend rest to it
-            callback( rest + sys_string( from, to ) );
+    size = requested;
+    memset( ptr + size, 0, 16 );
+    return ptr;
+}
 
-            from = to + 1;
+utils::MappedFile::MappedFile( const fs::path& filename ) {
+#ifdef _WIN32
+    std::ifstream file( filename.native(), std::ios::binary );
+    std::stringstream content;
+    content << file.rdbuf();
+    data = content.str();
+    view = data;
+#else
+    int file = ::open( filename.c_str(), O_RDONLY | O_CLOEXEC );
 
-            // search for git's single null terminators
-            while( ( to = std::char_traits<sys_string::value_type>::find( from, last - from, '\0' ) ) ) {
-                // two nulls -> no more output
-                if( from == to ) { goto end; }
+    if( file == -1 ) { return; }
 
-                callback( sys_string( from, to ) );
-                from = to + 1;
-            }
+    const size_t size = fileSize( file );
 
-            // keep rest for next fgets round
-            rest = sys_string( from, last );
+    if( size ) {
+        map = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, file, 0 );
 
-            // and clear buffer so we don't read old data
-            memset( buffer.data(), '\0', buffer.size() * sizeof( sys_string::value_type ) );
+        if( map == MAP_FAILED ) {
+            map = nullptr;
+        } else {
+            view = std::string_view( static_cast<const char*>( map ), size );
         }
     }
 
-end:
-    pclose( pipe );
+    close( file );
+#endif
 }
 
-// binary files have usually zero padding
-bool utils::isTextFile( const std::string_view& content ) {
-    //! \note https://en.wikipedia.org/wiki/List_of_file_signatures
+utils::MappedFile::~MappedFile() {
+#ifndef _WIN32
 
-    if( content.size() >= 4 ) {
-        // PDF -> binary
-        if( 0 == memcmp( content.data(), "%PDF", 4 ) ) { return false; }
+    if( map ) { munmap( map, view.size() ); }
 
-        // PostScript -> binary
-        if( 0 == memcmp( content.data(), "%!PS", 4 ) ) { return false; }
-    }
+#endif
+}
 
-    const bool hasDoubleZero = fromStd::strstr( content.data(), content.size(), "\0\0", 2 ) != nullptr;
-    return !hasDoubleZero;
+bool utils::isTextFile( const std::string_view& content ) {
+    return encoding::isAsciiCompatible( encoding::classify( content ) );
 }
 
 // splits content on newline
@@ -185,40 +250,264 @@ utils::Lines utils::parseContent( const char* data, const size_t size, const lon
     return lines;
 }
 
+#ifndef _WIN32
+namespace {
+//! per thread cache of directory fds for openat
+//! \note files of one directory are enqueued together, so a few entries are enough
+struct DirCache {
+    struct Entry {
+        std::string dir;
+        int fd = -1; // -1, if dir was seen only once so far
+    };
+
+    static constexpr size_t size = 8;
+    Entry entries[size];
+    size_t next = 0;
+
+    ~DirCache() {
+        for( const Entry& entry : entries ) {
+            if( entry.fd != -1 ) { close( entry.fd ); }
+        }
+    }
+
+    //! opens filename relative to its cached directory fd
+    int openRelative( const std::string& filename ) {
+        const size_t slash = filename.rfind( '/' );
+
+        if( slash == std::string::npos || slash == 0 ) {
+            return ::open( filename.c_str(), O_RDONLY | O_BINARY );
+        }
+
+        const std::string_view dir( filename.data(), slash );
+        const char* name = filename.c_str() + slash + 1;
+
+        for( Entry& entry : entries ) {
+            if( entry.dir != dir ) { continue; }
+
+            // second file in this dir, so it's worth to open it
+            if( entry.fd == -1 ) {
+#ifdef O_PATH
+                entry.fd = ::open( entry.dir.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC );
+#else
+                entry.fd = ::open( entry.dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+#endif
+
+                if( entry.fd == -1 ) { break; }
+            }
+
+            return openat( entry.fd, name, O_RDONLY | O_BINARY );
+        }
+
+        // unknown dir, remember it and open without cache
+        Entry& entry = entries[next];
+        next = ( next + 1 ) % size;
+
+        if( entry.fd != -1 ) { close( entry.fd ); }
+
+        entry.dir = dir;
+        entry.fd = -1;
+
+        return ::open( filename.c_str(), O_RDONLY | O_BINARY );
+    }
+};
+}
+#endif
+
+bool utils::transcode( FileView& view ) {
+    if( !encoding::needsTranscoding( view.encoding ) ) { return true; }
+
+    // second growing buffer for each thread
+    static thread_local utils::Buffer buffer;
+    char* ptr = buffer.grow( encoding::transcodedSize( view.encoding, view.content.size() ) );
+
+    if( !ptr ) { return false; }
+
+    size_t size = encoding::toUTF8( view.encoding, view.content.data(), view.content.size(), ptr );
+    buffer.size = size;
+    memset( ptr + size, 0, 16 );
+
+    view.huge = buffer.huge;
+    view.content = std::string_view( ptr, size );
+    return true;
+}
+
+bool utils::finish( FileView& view, const ReadOptions& options ) {
+    if( !view.deferred ) { return true; }
+
+    view.deferred = false;
+
+    if( view.compressed ) {
+        view.compressed = false;
+
+        if( !decompress( view, options ) ) {
+            view.size = 0;
+            return false;
+        }
+    }
+
+    return transcode( view );
+}
+
+bool utils::decompress( FileView& view, const ReadOptions& options ) {
+    // third growing buffer for each thread
+    static thread_local utils::Buffer buffer;
+
+    if( !compression::decompress( compression::detect( view.content ), view.content, buffer ) ) { return false; }
+
+    view.huge = buffer.huge;
+    view.content = std::string_view( buffer.ptr, buffer.size );
+
+    // like .tar.gz
+    if( options.archives && archive::detect( view.content ) != archive::Format::None ) {
+        view.archive = true;
+        return true;
+    }
+
+    if( options.binary ) { return true; }
+
+    view.encoding = encoding::classify( view.content );
+    return view.encoding != encoding::Encoding::Binary;
+}
+
 utils::FileView utils::fromFileP( const sys_string& filename ) {
+    return fromFileP( filename, ReadOptions() );
+}
+
+utils::FileView utils::fromFileP( const sys_string& filename, const ReadOptions& options ) {
+    // growing buffer for each thread
+    static thread_local utils::Buffer buffer;
+    return fromFileP( filename, options, buffer );
+}
+
+namespace {
+//! reads up to count bytes, retrying short reads until expected bytes or EOF,
+//! as read returns less than requested above 2 GB and on NFS or FUSE
+//! \returns bytes read, or -1 on error
+long long readUntil( const int file, char* ptr, const size_t count, const size_t expected ) {
+    size_t done = 0;
+
+    while( done < count ) {
+        const long long bytes = _read( file, ptr + done, std::min<size_t>( count - done, 1024_MB ) );
+
+        if( bytes < 0 ) { return -1; }
+
+        if( bytes == 0 ) { break; }
+
+        done += bytes;
+
+        if( done >= expected ) { break; }
+    }
+
+    return done;
+}
+}
+
+utils::FileView utils::fromFileP( const sys_string& filename, const ReadOptions& options, Buffer& buffer ) {
     FileView view;
+#ifndef _WIN32
+    static thread_local DirCache dirs;
+    int file = dirs.openRelative( filename );
+#else
     int file = open( filename.c_str(), O_RDONLY | O_BINARY );
+#endif
     IF_RET( file == -1 );
     utils::ScopeGuard onExit( [file] { close( file ); } );
 
-    view.size = utils::fileSize( file );
-    IF_RET( !view.size );
+    char* ptr = buffer.ptr;
 
-    // growing buffer for each thread
-    static thread_local utils::Buffer buffer;
-    char* ptr = buffer.grow( view.size );
+    // read first 64 kB without fstat, a short read means EOF
+    const size_t first = std::min<size_t>( buffer.reserved, 64_kB );
+    long long bytes = -1;
 
-    // read first 4 kB
-    size_t offset = std::min<size_t>( view.size, 4_kB );
-    size_t bytes = _read( file, ptr, offset );
-    IF_RET( offset != bytes );
+#ifdef RWF_NOWAIT
+    // probes the page cache, EAGAIN, if the first page is not cached, and a short read, if only some are
+    if( options.nowait ) {
+        struct iovec block = { ptr, first };
+        bytes = preadv2( file, &block, 1, -1, RWF_NOWAIT );
 
-    // check first 300 bytes for binary
-    IF_RET( !utils::isTextFile( std::string_view( ptr, std::min<size_t>( offset, 300ul ) ) ) );
+        view.uncached = bytes < 0 && errno == EAGAIN;
+        IF_RET( view.uncached );
 
-    // read rest
-    if( view.size > offset ) {
-        size_t newSize = view.size - offset;
-        size_t bytes2 = _read( file, ptr + offset, newSize );
-        IF_RET( newSize != bytes2 );
+        if( bytes > 0 && static_cast<size_t>( bytes ) < first ) {
+            const long long rest = _read( file, ptr + bytes, first - bytes );
+            IF_RET( rest < 0 );
+            bytes += rest;
+        }
+    }
+#endif
+
+    // filesystems without RWF_NOWAIT fail with EOPNOTSUPP and read like without nowait
+    if( bytes < 0 ) { bytes = _read( file, ptr, first ); }
+
+    IF_RET( bytes <= 0 );
+    view.size = bytes;
+
+    // compressed files are classified after decompression
+    const bool compressed = options.decompress &&
+                            compression::isSupported( compression::detect( std::string_view( ptr, view.size ) ) );
+
+    // archives are classified member by member
+    view.archive = options.archives && archive::detect( std::string_view( ptr, view.size ) ) != archive::Format::None;
+
+    // check first block for binary
+    if( !compressed && !view.archive && !options.binary ) {
+        view.encoding = encoding::classify( std::string_view( ptr, view.size ) );
+        IF_RET( view.encoding == encoding::Encoding::Binary );
+    }
+
+    // large file with known size, read one byte more than expected, reading less than expected means EOF again
+    if( view.size == first && options.sizeHint >= first ) {
+        buffer.size = first;
+        ptr = buffer.extend( options.sizeHint + 1 );
+        IF_RET( !ptr );
+        long long bytes2 = readUntil( file, ptr + first, options.sizeHint + 1 - first, options.sizeHint - first );
+        IF_RET( bytes2 < 0 );
+        view.size = first + bytes2;
     }
 
+    // large file, get real size and read rest
+    if( view.size == std::max( first, options.sizeHint + 1 ) ) {
+        const size_t size = std::max( utils::fileSize( file ), view.size );
+        buffer.size = view.size;
+        ptr = buffer.extend( size );
+        IF_RET( !ptr );
+
+        if( size > view.size ) {
+            long long bytes2 = readUntil( file, ptr + view.size, size - view.size, size - view.size );
+            IF_RET( bytes2 < 0 );
+            view.size += bytes2;
+        }
+    }
+
+    view.huge = buffer.huge;
+
+    // zero padding for ssestr
+    memset( ptr + view.size, 0, 16 );
+
     view.content = std::string_view( ptr, view.size );
+
+    if( options.deferred ) {
+        view.compressed = compressed;
+        view.deferred = true;
+        return view;
+    }
+
+    if( compressed ) {
+        IF_RET( !decompress( view, options ) );
+    }
+
+    IF_RET( !transcode( view ) );
     return view;
 }
 
 #ifdef _WIN32
-utils::FileView utils::fromWinAPI( const sys_string& filename ) {
+utils::FileView utils::fromWinAPI( const sys_string& filename, const ReadOptions& options ) {
+    // growing buffer for each thread
+    static thread_local utils::Buffer buffer;
+    return fromWinAPI( filename, options, buffer );
+}
+
+utils::FileView utils::fromWinAPI( const sys_string& filename, const ReadOptions& options, Buffer& buffer ) {
     utils::FileView view;
     HANDLE file = ::CreateFileW( filename.c_str(),      // file to open
                                  GENERIC_READ,          // open for reading
@@ -234,9 +523,8 @@ utils::FileView utils::fromWinAPI( const sys_string& filename ) {
     view.size = ::GetFileSize( file, nullptr );
     IF_RET( !view.size );
 
-    // growing buffer for each thread
-    static thread_local utils::Buffer buffer;
     char* ptr = buffer.grow( view.size );
+    IF_RET( !ptr );
     DWORD read = 0;
 
     // read first 4 kB
@@ -248,8 +536,18 @@ utils::FileView utils::fromWinAPI( const sys_string& filename ) {
                           nullptr );
     IF_RET( !ok );
 
-    // check first 300 bytes for binary
-    IF_RET( !utils::isTextFile( std::string_view( ptr, std::min<size_t>( offset, 300ul ) ) ) );
+    // compressed files are classified after decompression
+    const bool compressed = options.decompress &&
+                            compression::isSupported( compression::detect( std::string_view( ptr, offset ) ) );
+
+    // archives are classified member by member
+    view.archive = options.archives && archive::detect( std::string_view( ptr, offset ) ) != archive::Format::None;
+
+    // check first block for binary
+    if( !compressed && !view.archive && !options.binary ) {
+        view.encoding = encoding::classify( std::string_view( ptr, offset ) );
+        IF_RET( view.encoding == encoding::Encoding::Binary );
+    }
 
     // read rest
     if( view.size > offset ) {
@@ -262,82 +560,409 @@ utils::FileView utils::fromWinAPI( const sys_string& filename ) {
     }
 
     view.content = std::string_view( ptr, view.size );
+
+    if( options.deferred ) {
+        view.compressed = compressed;
+        view.deferred = true;
+        return view;
+    }
+
+    if( compressed ) {
+        IF_RET( !decompress( view, options ) );
+    }
+
+    IF_RET( !transcode( view ) );
     return view;
 }
 #endif
 
+namespace {
+using Inode = std::pair<uint64_t, uint64_t>; // device and inode
+
+struct InodeHash {
+    size_t operator()( const Inode& inode ) const {
+        return std::hash<uint64_t>()( inode.first * 0x9E3779B97F4A7C15ull ^ inode.second );
+    }
+};
+
+//! visited inodes of Links, sharded, so the walkers and workers rarely wait for each other
+struct alignas( 64 ) InodeShard {
+    std::mutex m;
+    std::unordered_set<Inode, InodeHash> inodes;
+};
+
+std::array<InodeShard, 64>& inodeShards() {
+    static std::array<InodeShard, 64> shards;
+    return shards;
+}
+}
+
+bool utils::Links::visit( const uint64_t dev, const uint64_t ino ) {
+    const Inode inode( dev, ino );
+    InodeShard& shard = inodeShards()[InodeHash()( inode ) % inodeShards().size()];
+    std::unique_lock<std::mutex> lock( shard.m );
+    return shard.inodes.insert( inode ).second;
+}
+
+bool utils::fileId( const sys_string& path, uint64_t& dev, uint64_t& ino ) {
 #ifndef _WIN32
-void utils::recurseDir( const sys_string& filename, const std::function<void( const sys_string& filename )>& callback ) {
-    DIR* dir = opendir( filename.c_str() );
+    struct stat st;
+
+    if( stat( path.c_str(), &st ) != 0 ) { return false; }
+
+    dev = st.st_dev;
+    ino = st.st_ino;
+    return true;
+#else
+    ( void )path;
+    ( void )dev;
+    ( void )ino;
+    return false;
+#endif
+}
+
+size_t utils::cpuCount() {
+    size_t cpus = std::max( std::thread::hardware_concurrency(), 1u );
+#ifdef __linux__
+    cpu_set_t set;
+
+    if( sched_getaffinity( 0, sizeof( set ), &set ) == 0 ) { cpus = std::max( CPU_COUNT( &set ), 1 ); }
+
+    // quota and period in us, cgroup v2 has "max" or "quota period" in cpu.max, v1 has them in two files
+    const auto limit = [&cpus]( const long long quota, const long long period ) {
+        if( quota > 0 && period > 0 ) {
+            cpus = std::min<size_t>( cpus, std::max<long long>( ( quota + period - 1 ) / period, 1 ) );
+        }
+    };
+
+    std::string relative;
+    std::ifstream cgroups( "/proc/self/cgroup" );
+
+    for( std::string line; std::getline( cgroups, line ); ) {
+        if( line.compare( 0, 3, "0::" ) == 0 ) { relative = line.substr( 3 ); }
+    }
+
+    // each level limits its subtree, so take the smallest quota from the own cgroup up to the root
+    bool v2 = false;
+
+    for( std::string dir = relative;; dir.erase( dir.rfind( '/' ) ) ) {
+        std::ifstream max( "/sys/fs/cgroup" + dir + "/cpu.max" );
+        std::string quota;
+        long long period = 0;
+
+        if( max >> quota >> period ) {
+            v2 = true;
+
+            if( quota != "max" ) { limit( std::atoll( quota.c_str() ), period ); }
+        }
+
+        if( dir.find( '/' ) == std::string::npos ) { break; }
+    }
+
+    if( !v2 ) {
+        long long quota = -1;
+        long long period = 0;
+        std::ifstream( "/sys/fs/cgroup/cpu/cpu.cfs_quota_us" ) >> quota;
+        std::ifstream( "/sys/fs/cgroup/cpu/cpu.cfs_period_us" ) >> period;
+        limit( quota, period );
+    }
+
+#endif
+    return cpus;
+}
+
+#ifdef __linux__
+namespace {
+//! \returns numbers of a sysfs list like "0-3,8-11"
+std::vector<int> parseList( const std::string& list ) {
+    std::vector<int> numbers;
+    std::istringstream ranges( list );
+
+    for( std::string range; std::getline( ranges, range, ',' ); ) {
+        int from = 0;
+        int to = 0;
+        const int parsed = sscanf( range.c_str(), "%d-%d", &from, &to );
+
+        if( parsed < 1 ) { continue; }
+
+        for( int i = from; i <= ( parsed == 2 ? to : from ); ++i ) { numbers.push_back( i ); }
+    }
+
+    return numbers;
+}
+}
+#endif
+
+std::vector<int> utils::cpuOrder() {
+    std::vector<int> order;
+#ifdef __linux__
+    cpu_set_t set;
+
+    if( sched_getaffinity( 0, sizeof( set ), &set ) != 0 ) { return order; }
+
+    // usable CPUs of each online node, one node without NUMA
+    std::vector<std::vector<int>> nodes;
+    std::string online;
+    std::getline( std::ifstream( "/sys/devices/system/node/online" ), online );
+
+    for( const int node : parseList( online ) ) {
+        std::string list;
+        std::getline( std::ifstream( format( "/sys/devices/system/node/node%d/cpulist", node ) ), list );
+        nodes.emplace_back();
+
+        for( const int cpu : parseList( list ) ) {
+            if( cpu < CPU_SETSIZE && CPU_ISSET( cpu, &set ) ) { nodes.back().push_back( cpu ); }
+        }
+    }
+
+    if( nodes.empty() ) {
+        nodes.emplace_back();
+
+        for( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+            if( CPU_ISSET( cpu, &set ) ) { nodes.back().push_back( cpu ); }
+        }
+    }
+
+    for( size_t i = 0; order.size() < size_t( CPU_COUNT( &set ) ); ++i ) {
+        const size_t before = order.size();
+
+        for( const std::vector<int>& cpus : nodes ) {
+            if( i < cpus.size() ) { order.push_back( cpus[i] ); }
+        }
+
+        // CPUs in the mask, but in no node
+        if( order.size() == before ) { break; }
+    }
+
+#endif
+    return order;
+}
+
+bool utils::isRotational( const sys_string& path ) {
+#ifdef __linux__
+    struct stat st;
+
+    if( stat( path.c_str(), &st ) != 0 ) { return false; }
+
+    // partitions have no queue of their own, it is in the directory of their disk
+    const std::string device = format( "/sys/dev/block/%u:%u/", major( st.st_dev ), minor( st.st_dev ) );
 
-    if( !dir ) { return; }
+    for( const char* queue : { "queue/rotational", "../queue/rotational" } ) {
+        int rotational = 0;
 
+        if( std::ifstream( device + queue ) >> rotational ) { return rotational == 1; }
+    }
+
+#endif
+    return false;
+}
+
+bool utils::Links::visit( const sys_string& path ) {
+    uint64_t dev = 0;
+    uint64_t ino = 0;
+
+    // missing files are left to the caller
+    return !fileId( path, dev, ino ) || visit( dev, ino );
+}
+
+void utils::Links::clear() {
+    for( InodeShard& shard : inodeShards() ) {
+        std::unique_lock<std::mutex> lock( shard.m );
+        shard.inodes.clear();
+    }
+}
+
+thread_local uint64_t utils::listedInode = 0;
+
+#ifndef _WIN32
+namespace {
+//! calls onFile or onDir for an entry of the open directory dir
+//! \note some XFS, NFS and overlay setups don't fill d_type, these entries are resolved with fstatat
+//! \returns true, if the entry is .git, which is skipped
+bool listEntry( const int dir, const sys_string& path, const char* name, unsigned char type, uint64_t inode,
+                const std::function<void( const sys_string& filename )>& onFile,
+                const std::function<void( const sys_string& dirname )>& onDir ) {
+    // directory in repos, file in submodules and worktrees
+    if( !strcmp( name, ".git" ) ) { return true; }
+
+    if( type == DT_UNKNOWN ) {
+        struct stat st;
+
+        if( fstatat( dir, name, &st, AT_SYMLINK_NOFOLLOW ) != 0 ) { return false; }
+
+        if( S_ISREG( st.st_mode ) ) { type = DT_REG; }
+
+        if( S_ISDIR( st.st_mode ) ) { type = DT_DIR; }
+
+        if( S_ISLNK( st.st_mode ) ) { type = DT_LNK; }
+    }
+
+    // with -L, links are listed as their targets, dangling links are skipped
+    if( type == DT_LNK && utils::Links::follow ) {
+        struct stat st;
+
+        if( fstatat( dir, name, &st, 0 ) != 0 ) { return false; }
+
+        if( S_ISREG( st.st_mode ) ) { type = DT_REG; }
+
+        if( S_ISDIR( st.st_mode ) ) { type = DT_DIR; }
+
+        inode = st.st_ino;
+    }
+
+    if( type == DT_REG ) {
+        utils::listedInode = inode;
+        onFile( path + name );
+        return false;
+    }
+
+    if( type == DT_DIR ) {
+        if( !strcmp( name, "." ) ) { return false; }
+
+        if( !strcmp( name, ".." ) ) { return false; }
+
+        if( !strcmp( name, ".svn" ) ) { return false; }
+
+        if( !strcmp( name, ".hg" ) ) { return false; }
+
+        onDir( path + name );
+        return false;
+    }
+
+    return false;
+}
+
+#ifdef __linux__
+//! layout of the entries returned by getdents64
+struct linux_dirent64 {
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+#endif
+}
+
+bool utils::listDir( const sys_string& filename,
+                     const std::function<void( const sys_string& filename )>& onFile,
+                     const std::function<void( const sys_string& dirname )>& onDir ) {
     // add slash only, if there is none
-    const char* slash = filename.back() == '/' ? "" : "/";
+    const sys_string path = filename.back() == '/' ? filename : filename + "/";
+    bool repo = false;
 
-    struct dirent* dp = nullptr;
+#ifdef __linux__
+    int dir = open( filename.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
 
-    while( ( dp = readdir( dir ) ) != nullptr ) {
+    if( dir == -1 ) { return false; }
 
-        if( dp->d_type == DT_REG ) {
-            callback( filename + slash + dp->d_name );
-            continue;
+    // with -L, directories reachable through links are listed once, which breaks cycles, too
+    if( Links::follow ) {
+        struct stat st;
+
+        if( fstat( dir, &st ) != 0 || !Links::visit( st.st_dev, st.st_ino ) ) {
+            close( dir );
+            return false;
         }
+    }
 
-        if( dp->d_type == DT_DIR ) {
-            if( !strcmp( dp->d_name, "." ) ) { continue; }
+    // readdir fills 32 kB per syscall, this lists even large directories at once
+    static thread_local std::vector<char> buffer( 256_kB );
 
-            if( !strcmp( dp->d_name, ".." ) ) { continue; }
+    // onDir may recurse and reuse the buffer, so subdirectories are passed after listing
+    std::vector<sys_string> dirs;
+    auto collect = [&dirs]( const sys_string & dirname ) { dirs.push_back( dirname ); };
 
-            if( !strcmp( dp->d_name, ".git" ) ) { continue; }
+    for( ;; ) {
+        long bytes = syscall( SYS_getdents64, dir, buffer.data(), buffer.size() );
 
-            if( !strcmp( dp->d_name, ".svn" ) ) { continue; }
+        if( bytes <= 0 ) { break; }
 
-            if( !strcmp( dp->d_name, ".hg" ) ) { continue; }
+        for( long pos = 0; pos < bytes; ) {
+            const linux_dirent64* entry = reinterpret_cast<const linux_dirent64*>( buffer.data() + pos );
+            pos += entry->d_reclen;
+            repo |= listEntry( dir, path, entry->d_name, entry->d_type, entry->d_ino, onFile, collect );
+        }
+    }
 
-            utils::recurseDir( filename + slash + dp->d_name, callback );
-            continue;
+    // fewer open fds during recursion
+    close( dir );
+
+    for( const sys_string& dirname : dirs ) { onDir( dirname ); }
+
+#else
+    DIR* dir = opendir( filename.c_str() );
+
+    if( !dir ) { return false; }
+
+    if( Links::follow ) {
+        struct stat st;
+
+        if( fstat( dirfd( dir ), &st ) != 0 || !Links::visit( st.st_dev, st.st_ino ) ) {
+            closedir( dir );
+            return false;
         }
+    }
 
-        // if( dp->d_type == DT_LNK ) { continue; }
+    struct dirent* dp = nullptr;
+
+    while( ( dp = readdir( dir ) ) != nullptr ) {
+        repo |= listEntry( dirfd( dir ), path, dp->d_name, dp->d_type, dp->d_ino, onFile, onDir );
     }
 
     closedir( dir );
+#endif
+    return repo;
 }
 #else
-void utils::recurseDir( const sys_string& filename, const std::function<void ( const sys_string& filename )>& callback ) {
+bool utils::listDir( const sys_string& filename,
+                     const std::function<void( const sys_string& filename )>& onFile,
+                     const std::function<void( const sys_string& dirname )>& onDir ) {
     WIN32_FIND_DATAW data = {};
 
     std::wstring withGlob = filename + L"\\*";
     HANDLE file = FindFirstFileExW( withGlob.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, 0 );
 
-    if( !file ) { return; }
+    if( !file ) { return false; }
+
+    bool repo = false;
 
     while( FindNextFileW( file, &data ) ) {
 
+        // directory in repos, file in submodules and worktrees
+        if( !wcscmp( data.cFileName, L".git" ) ) {
+            repo = true;
+            continue;
+        }
+
         if( data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) {
             if( !wcscmp( data.cFileName, L".." ) ) { continue; }
 
-            if( !wcscmp( data.cFileName, L".git" ) ) { continue; }
-
             if( !wcscmp( data.cFileName, L".svn" ) ) { continue; }
 
             if( !wcscmp( data.cFileName, L".hg" ) ) { continue; }
 
-            recurseDir( filename + data.cFileName + L"\\", callback );
+            onDir( filename + data.cFileName + L"\\" );
             continue;
         }
 
         if( data.dwFileAttributes & ( FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_NORMAL ) ) {
-            callback( filename + data.cFileName );
+            onFile( filename + data.cFileName );
             continue;
         }
     }
 
     FindClose( file );
+    return repo;
 }
 #endif
 
+void utils::recurseDir( const sys_string& filename, const std::function<void( const sys_string& filename )>& callback ) {
+    listDir( filename, callback, [&callback]( const sys_string & dirname ) {
+        recurseDir( dirname, callback );
+    } );
+}
+
 size_t utils::fileSize( const int file ) {
     struct stat st {};
 
@@ -4,12 +4,12 @@
 #include <iostream>
 #include <functional>
 #include <vector>
+#include <atomic>
+#include <cstring>
 
 #ifdef _WIN32
 #include <io.h>
 #include <Shlwapi.h>
-#define popen  _popen
-#define pclose _pclose
 #define open   _wopen
 #define fopen  _wfopen
 #define close  _close
@@ -29,6 +29,8 @@
 #include "boost/filesystem.hpp"
 #include "boost/align/aligned_alloc.hpp"
 
+#include "encoding.hpp"
+
 namespace fs = boost::filesystem;
 using sys_string = fs::path::string_type;
 namespace os = boost::system;
@@ -65,15 +67,29 @@ struct ScopeGuard {
 };
 
 struct Buffer {
+    //! buffers from this size on are backed by 2 MB pages to save TLB misses
+    static constexpr size_t hugeThreshold = 4_MB;
+    static constexpr size_t hugePageSize = 2_MB;
+    //! if true, take huge pages from the hugetlbfs pool, see /proc/sys/vm/nr_hugepages
+    static inline std::atomic_bool useHugeTLB = {false};
+
     size_t size = 0;
     size_t reserved = 1_MB;
-    // align at 128 bits for ssestr
-    char* ptr = static_cast<char*>( boost::alignment::aligned_alloc( 16, reserved + 16 ) );
+    size_t mapped = 0; // mmap'ed bytes, 0 if aligned_alloc'ed
+    bool huge = false;
+    char* ptr = nullptr;
+
+    Buffer() { allocate( reserved ); }
+
+    //! \returns ptr, or nullptr if there is not enough memory, the buffer is empty then
     inline char* grow( const size_t requested ) {
-        if( reserved < requested ) {
-            reserved = requested;
-            boost::alignment::aligned_free( ptr );
-            ptr = static_cast<char*>( boost::alignment::aligned_alloc( 16, reserved + 16 ) );
+        if( reserved < requested || !ptr ) {
+            release( ptr, mapped );
+
+            if( !allocate( requested ) ) {
+                size = 0;
+                return nullptr;
+            }
         }
 
         size = requested;
@@ -81,15 +97,47 @@ struct Buffer {
         return ptr;
     }
 
-    ~Buffer() {
-        boost::alignment::aligned_free( ptr );
-    }
+    //! like grow, but keeps the first size bytes
+    //! \returns ptr, or nullptr if there is not enough memory, the buffer is unchanged then
+    char* extend( const size_t requested );
+
+    ~Buffer() { release( ptr, mapped ); }
+
+    private:
+        //! sets ptr, reserved, mapped and huge
+        //! \returns false, if there is not enough memory, ptr is nullptr and reserved 0 then
+        bool allocate( const size_t requested );
+        static void release( char* ptr, const size_t mapped );
+};
+
+//! read only view of a whole file, mmap'ed on POSIX
+class MappedFile {
+    public:
+        explicit MappedFile( const fs::path& filename );
+        MappedFile( const MappedFile& ) = delete;
+        MappedFile& operator=( const MappedFile& ) = delete;
+        ~MappedFile();
+        //! \returns content, empty if the file is missing or empty
+        const std::string_view& content() const { return view; }
+    private:
+        std::string_view view;
+#ifdef _WIN32
+        std::string data;
+#else
+        void* map = nullptr;
+#endif
 };
 
 using Lines = std::vector<std::string_view>;
 
 struct FileView {
     size_t size = 0;
+    bool huge = false; // content is backed by huge pages
+    encoding::Encoding encoding = encoding::Encoding::UTF8; // of the file, content is always UTF-8
+    bool archive = false; // content is a tar or zip archive, see archive::walk
+    bool compressed = false; // content is still gzip or zstd compressed, see ReadOptions::deferred
+    bool deferred = false; // content is left to finish, see ReadOptions::deferred
+    bool uncached = false; // not read, because the first block is not in the page cache, see ReadOptions::nowait
     Lines lines;
     std::string_view content;
 };
@@ -97,23 +145,48 @@ struct FileView {
 //! prints text in color to stdout
 void printColor( Color color, const std::string& text );
 
-//! runs shell command
-//! \returns output of command as vector
-void gitLsFiles( const boost::filesystem::path& path, const std::function<void( const sys_string& filename )>& callback );
-
-//! \returns true, if filename has no "\0\0" in the first 1000 bytes
+//! \returns true, if the first block of content is ASCII, UTF-8 or Latin-1
+//! \sa encoding::classify
 bool isTextFile( const std::string_view& content );
 
+//! how fromFileP treats files besides plain text
+struct ReadOptions {
+    bool decompress = false; // search in gzip and zstd compressed files
+    bool archives = false;   // read tar and zip archives unclassified
+    bool binary = false;     // read all files unclassified and untranscoded
+    size_t sizeHint = 0;     // expected size like from the git index, saves the fstat of large files
+    bool deferred = false;   // classify only, decompression and transcoding are left to finish on another thread
+    bool nowait = false;     // read only, if the first block is in the page cache, else set FileView::uncached, Linux only
+};
+
 #define IF_RET( A ) if( A ) { view.size = 0; return view; }
 
+//! transcodes UTF-16 and Latin-1 content of view to UTF-8 into a thread local buffer
+//! \returns false, if there is not enough memory
+bool transcode( FileView& view );
+
+//! decompresses content of view into a thread local buffer and classifies it
+//! \returns false, if the content is corrupt or binary
+bool decompress( FileView& view, const ReadOptions& options = ReadOptions() );
+
+//! reads optimistically until a short read, so small files cost only open, read and close
 //! \returns content of filename as vector with C API
 FileView fromFileP( const sys_string& filename );
+FileView fromFileP( const sys_string& filename, const ReadOptions& options );
+//! like fromFileP, but reads into buffer instead of a thread local one
+FileView fromFileP( const sys_string& filename, const ReadOptions& options, Buffer& buffer );
 
 #ifdef _WIN32
 //! \returns content of filename as vector with WINAPI
-FileView fromWinAPI( const sys_string& filename );
+FileView fromWinAPI( const sys_string& filename, const ReadOptions& options = ReadOptions() );
+//! like fromWinAPI, but reads into buffer instead of a thread local one
+FileView fromWinAPI( const sys_string& filename, const ReadOptions& options, Buffer& buffer );
 #endif
 
+//! decompresses and transcodes view read with ReadOptions::deferred into thread local buffers, like the read would have
+//! \returns false, if the content is corrupt or binary
+bool finish( FileView& view, const ReadOptions& options );
+
 //! splits content at newlines
 //! \returns lines as vector of string_view
 Lines parseContent( const char* data, const size_t size, const long long stop );
@@ -140,9 +213,67 @@ inline std::function<void()> printFunc( Color color, const std::string text ) {
 //! opens file with platforms standard program
 bool openFile( const sys_string& filename );
 
+//! sets dev and ino of the file at path, following links
+//! \returns false, if path can't be stat'ed, or on windows
+bool fileId( const sys_string& path, uint64_t& dev, uint64_t& ino );
+
+//! \returns CPUs this process may use, the smaller of its affinity mask and its cgroup CPU quota, at least 1
+size_t cpuCount();
+
+//! \returns CPUs of the affinity mask of this process, taking turns between the NUMA nodes,
+//! so that the first n of them spread over all nodes, empty if unknown
+std::vector<int> cpuOrder();
+
+//! \returns true, if the block device of path is a spinning disk, false for SSDs, network and virtual filesystems
+bool isRotational( const sys_string& path );
+
+//! symlinks followed by listDir with -L, each directory and file is visited once by its device and inode,
+//! which breaks cycles and skips files reachable through several links
+//! \note not supported on windows, where links are never followed
+struct Links {
+    static inline std::atomic_bool follow = {false};
+
+    //! \returns true, if the directory or file with dev and ino was not visited before
+    static bool visit( const uint64_t dev, const uint64_t ino );
+    //! like visit, with device and inode of the file at path, following links
+    //! \returns true, if path can't be stat'ed
+    static bool visit( const sys_string& path );
+    //! forgets the visited directories and files
+    static void clear();
+};
+
+//! lists files and subdirectories of a single directory, skips .git, .svn and .hg
+//! and symlinks, unless Links::follow is set
+//! \note on windows, filename must end with a path separator
+//! \returns true, if the directory has a .git directory or a .git file like submodules, so it is a repo
+bool listDir( const sys_string& filename,
+              const std::function<void( const sys_string& filename )>& onFile,
+              const std::function<void( const sys_string& dirname )>& onDir );
+
+//! inode of the file, which listDir passes to onFile on this thread, from its directory entry, 0 if unknown
+//! \note walkers, which pass the files on later, set it again for each file
+extern thread_local uint64_t listedInode;
+
 //! \note on windows, filename must end with a path separator
 void recurseDir( const sys_string& filename, const std::function<void( const sys_string& filename )>& callback );
 
+//! like recurseDir, but lists each subdirectory in its own job on pool
+//! \param descend returns false for subdirectories, which are skipped, if set
+//! \param onListed called by the same thread after the files of each directory were passed to callback, if set
+//! \note pool must accept jobs from its workers and must wait for them, before it is destroyed
+template<class Pool>
+void recurseDirParallel( Pool& pool, const sys_string& filename, const std::function<void( const sys_string& filename )>& callback,
+                         const std::function<bool( const sys_string& dirname )>& descend = nullptr,
+                         const std::function<void()>& onListed = nullptr ) {
+    listDir( filename, callback, [&pool, callback, descend, onListed]( const sys_string & dirname ) {
+        if( descend && !descend( dirname ) ) { return; }
+
+        pool.add( [&pool, callback, descend, onListed, dirname] { recurseDirParallel( pool, dirname, callback, descend, onListed ); } );
+    } );
+
+    if( onListed ) { onListed(); }
+}
+
 sys_string absolutePath( const sys_string& filename = DOT );
 
 }
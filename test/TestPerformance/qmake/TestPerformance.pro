@@ -26,6 +26,12 @@ HEADERS += ../src/NewlineParser.hpp
 INCLUDEPATH += $${MAIN_DIR}/src
 HEADERS += $${MAIN_DIR}/src/utils.hpp
 SOURCES += $${MAIN_DIR}/src/utils.cpp
+HEADERS += $${MAIN_DIR}/src/encoding.hpp
+SOURCES += $${MAIN_DIR}/src/encoding.cpp
+HEADERS += $${MAIN_DIR}/src/compression.hpp
+SOURCES += $${MAIN_DIR}/src/compression.cpp
+HEADERS += $${MAIN_DIR}/src/archive.hpp
+SOURCES += $${MAIN_DIR}/src/archive.cpp
 
 HEADERS += $${MAIN_DIR}/src/pipes.hpp
 SOURCES += $${MAIN_DIR}/src/pipes.cpp
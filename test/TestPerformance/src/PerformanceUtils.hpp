@@ -45,7 +45,7 @@ inline Result runDirWalkerTest( const std::string& name, const decltype( utils::
 
     long ns = 0;
     {
-        POOL;
+        POOL( utils::cpuCount() );
         STOPWATCH
         START
 
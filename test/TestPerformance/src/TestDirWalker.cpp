@@ -63,6 +63,40 @@ void recurseDir( const sys_string& filename, const std::function<void( const sys
 }
 #endif
 
+#if !BOOST_OS_WINDOWS
+#include <dirent.h>
+
+namespace withReaddir {
+//! one entry per readdir call, skips entries without d_type
+void recurseDir( const sys_string& filename, const std::function<void( const sys_string& filename )>& callback ) {
+    DIR* dir = opendir( filename.c_str() );
+
+    if( !dir ) { return; }
+
+    const char* slash = filename.back() == '/' ? "" : "/";
+    struct dirent* dp = nullptr;
+
+    while( ( dp = readdir( dir ) ) != nullptr ) {
+        if( dp->d_type == DT_REG ) {
+            callback( filename + slash + dp->d_name );
+        } else if( dp->d_type == DT_DIR && strcmp( dp->d_name, "." ) && strcmp( dp->d_name, ".." ) && strcmp( dp->d_name, ".git" ) ) {
+            recurseDir( filename + slash + dp->d_name, callback );
+        }
+    }
+
+    closedir( dir );
+}
+}
+#endif
+
+namespace withPool {
+//! lists directories in parallel, files are still passed to callback
+void recurseDir( const sys_string& filename, const std::function<void( const sys_string& filename )>& callback ) {
+    POOL( utils::cpuCount() );
+    utils::recurseDirParallel( pool, filename, callback );
+}
+}
+
 
 BOOST_AUTO_TEST_CASE( Test_DirWalker ) {
     printf( "DirWalker\n" );
@@ -71,8 +105,10 @@ BOOST_AUTO_TEST_CASE( Test_DirWalker ) {
 #if !BOOST_OS_WINDOWS
         runDirWalkerTest( "withFTS", withFTS::recurseDir ),
         runDirWalkerTest( "withNFTW", withNFTW::recurseDir ),
+        runDirWalkerTest( "withReaddir", withReaddir::recurseDir ),
 #endif
         runDirWalkerTest( "utils", utils::recurseDir ),
+        runDirWalkerTest( "withPool", withPool::recurseDir ),
         runDirWalkerTest( "withBoost", withBoost::recurseDir ),
 #ifndef __APPLE__
         runDirWalkerTest( "withStd", withStd::recurseDir ),
@@ -1,6 +1,10 @@
 #include "boost/test/unit_test.hpp"
 #include "boost/asio.hpp"
 
+#include <array>
+#include <ctime>
+#include <set>
+
 #include "threadpool.hpp"
 #include "stopwatch.hpp"
 
@@ -58,3 +62,163 @@ BOOST_AUTO_TEST_CASE( Test_ThreadPool ) {
     printf( "            boost : %6ld us\n", ns_asio / 1000 );
     printf( "            async : %6ld us\n\n", ns_async / 1000 );
 }
+
+BOOST_AUTO_TEST_CASE( Test_ThreadPoolContention ) {
+    const unsigned threads = std::min( std::thread::hardware_concurrency(), 8u );
+    const int producers = 4;
+    const int perProducer = 25000;
+    long ns_asio = 0;
+    long ns_own = 0;
+    STOPWATCH
+
+    // external threads add jobs concurrently, while the jobs add more jobs like the directory walkers
+    auto contend = [&]( auto& pool, auto add, std::atomic_int& counter ) {
+        std::vector<std::thread> adders;
+
+        for( int p = 0; p < producers; ++p ) {
+            adders.emplace_back( [&] {
+                for( int i = 0; i < perProducer; ++i ) {
+                    add( pool, [&pool, &counter, add] {
+                        counter++;
+                        add( pool, [&counter] { counter++; } );
+                    } );
+                }
+            } );
+        }
+
+        for( std::thread& adder : adders ) { adder.join(); }
+    };
+
+    std::atomic_int counter = 0;
+    {
+        START
+        boost::asio::thread_pool pool( threads );
+        contend( pool, []( boost::asio::thread_pool & pool, const std::function<void()>& job ) { post( pool, job ); }, counter );
+        pool.join();
+        STOP( ns_asio );
+    }
+    BOOST_REQUIRE_EQUAL( counter, 2 * producers * perProducer );
+
+    counter = 0;
+    {
+        START {
+            ThreadPool pool( threads );
+            contend( pool, []( ThreadPool & pool, const std::function<void()>& job ) { pool.add( job ); }, counter );
+        }
+        STOP( ns_own );
+    }
+    BOOST_REQUIRE_EQUAL( counter, 2 * producers * perProducer );
+
+    printf( "Threadpool contention, %d producers, %d jobs\n", producers, 2 * producers * perProducer );
+    printf( "              own : %6ld us\n", ns_own / 1000 );
+    printf( "            boost : %6ld us\n\n", ns_asio / 1000 );
+}
+
+BOOST_AUTO_TEST_CASE( Test_ThreadPoolIdle ) {
+    const unsigned threads = std::min( std::thread::hardware_concurrency(), 8u );
+    const auto idle = std::chrono::milliseconds( 200 );
+
+    // workers wait for a slow producer like for a slow walker, parked workers cost no CPU
+    std::atomic_int counter = 0;
+    std::clock_t cpu = 0;
+    {
+        ThreadPool pool( threads );
+        pool.add( [&counter] { counter++; } );
+        const std::clock_t start = std::clock();
+        std::this_thread::sleep_for( idle );
+        cpu = std::clock() - start;
+        pool.add( [&counter] { counter++; } );
+    }
+    BOOST_REQUIRE_EQUAL( counter, 2 );
+
+    const long cpu_ms = static_cast<long>( cpu * 1000 / CLOCKS_PER_SEC );
+    printf( "Threadpool idle for %ld ms with %u threads\n", static_cast<long>( idle.count() ), threads );
+    printf( "              own : %6ld ms CPU\n\n", cpu_ms );
+
+    BOOST_CHECK_LT( cpu_ms, idle.count() / 10 );
+}
+
+BOOST_AUTO_TEST_CASE( Test_ThreadPoolLimit ) {
+    const int jobs = 1000;
+    std::mutex m;
+    std::set<std::thread::id> ids;
+    std::atomic_int counter = 0;
+
+    auto job = [&] {
+        counter++;
+        std::unique_lock<std::mutex> lock( m );
+        ids.insert( std::this_thread::get_id() );
+    };
+
+    // only the active workers take jobs
+    {
+        ThreadPool pool( 4 );
+        pool.limit( 100 );
+        BOOST_CHECK_EQUAL( pool.active(), pool.size() );
+        pool.limit( 0 );
+        BOOST_CHECK_EQUAL( pool.active(), 1 );
+
+        for( int i = 0; i < jobs; ++i ) { pool.add( job ); }
+    }
+    BOOST_REQUIRE_EQUAL( counter, jobs );
+    BOOST_CHECK_EQUAL( ids.size(), 1 );
+
+    // raised and lowered while jobs are running, all jobs finish
+    counter = 0;
+    {
+        ThreadPool pool( 4 );
+        pool.limit( 2 );
+
+        for( int i = 0; i < jobs; ++i ) {
+            pool.add( [&pool, &counter, i] {
+                counter++;
+
+                if( i % 100 == 0 ) { pool.limit( i % 200 ? 4 : 1 ); }
+            } );
+        }
+    }
+    BOOST_REQUIRE_EQUAL( counter, jobs );
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE( Test_ThreadPoolPin ) {
+    // pinned workers run their jobs on their CPU only
+    cpu_set_t set;
+    BOOST_REQUIRE_EQUAL( sched_getaffinity( 0, sizeof( set ), &set ), 0 );
+    int cpu = 0;
+
+    while( !CPU_ISSET( cpu, &set ) ) { ++cpu; }
+
+    std::mutex m;
+    std::set<int> cpus;
+    {
+        ThreadPool pool( 4 );
+        pool.pin( { cpu } );
+
+        for( int i = 0; i < 100; ++i ) {
+            pool.add( [&m, &cpus] {
+                std::unique_lock<std::mutex> lock( m );
+                cpus.insert( sched_getcpu() );
+            } );
+        }
+    }
+    BOOST_CHECK( cpus == std::set<int>( { cpu } ) );
+}
+#endif
+
+BOOST_AUTO_TEST_CASE( Test_ThreadPoolStates ) {
+    std::atomic_int counter = 0;
+    {
+        ThreadPool pool( std::min( std::thread::hardware_concurrency(), 8u ) );
+
+        for( int i = 0; i < 1000; ++i ) {
+            // small states are stored inline, large ones on the heap, move only ones are moved in
+            std::array<int, 256> large;
+            large.fill( 1 );
+            pool.add( [&counter] { counter++; } );
+            pool.add( [&counter, large] { counter += large.back(); } );
+            pool.add( [&counter, moved = std::make_unique<int>( 1 )] { counter += *moved; } );
+        }
+    }
+    BOOST_REQUIRE_EQUAL( counter, 3000 );
+}
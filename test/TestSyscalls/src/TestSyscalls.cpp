@@ -0,0 +1,187 @@
+#define BOOST_TEST_MODULE Syscalls
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils.hpp"
+
+#if BOOST_OS_LINUX
+
+#include <cstdarg>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// syscalls per small file: open, read, close
+// plus opening and closing the cached directory fds
+#define BUDGET_SMALL 3.2
+// syscalls per large file: open, read, fstat, read, close
+#define BUDGET_LARGE 5.5
+// syscalls per large file with size from the git index: open, read, read, close
+#define BUDGET_HINTED 4.5
+
+namespace {
+// count only on the test thread while counting is set
+thread_local bool counting = false;
+thread_local size_t syscalls = 0;
+// caps each read on the test thread, like NFS or FUSE, 0 reads all requested bytes
+thread_local size_t readLimit = 0;
+
+template<class Func>
+Func* next( const char* name ) {
+    static_assert( std::is_function<Func>::value );
+    return reinterpret_cast<Func*>( dlsym( RTLD_NEXT, name ) );
+}
+
+inline void count() {
+    if( counting ) { ++syscalls; }
+}
+}
+
+// the optional mode argument of open
+#define MODE( flags ) \
+    mode_t mode = 0; \
+    if( flags & ( O_CREAT | O_TMPFILE ) ) { \
+        va_list args; \
+        va_start( args, flags ); \
+        mode = va_arg( args, mode_t ); \
+        va_end( args ); \
+    }
+
+// wrap the libc functions, which are used in utils.cpp
+extern "C" {
+    int open( const char* path, int flags, ... ) {
+        count();
+        static auto real = next<int( const char*, int, ... )>( "open" );
+        MODE( flags );
+        return real( path, flags, mode );
+    }
+    int open64( const char* path, int flags, ... ) {
+        count();
+        static auto real = next<int( const char*, int, ... )>( "open64" );
+        MODE( flags );
+        return real( path, flags, mode );
+    }
+    int openat( int dir, const char* path, int flags, ... ) {
+        count();
+        static auto real = next<int( int, const char*, int, ... )>( "openat" );
+        MODE( flags );
+        return real( dir, path, flags, mode );
+    }
+    int openat64( int dir, const char* path, int flags, ... ) {
+        count();
+        static auto real = next<int( int, const char*, int, ... )>( "openat64" );
+        MODE( flags );
+        return real( dir, path, flags, mode );
+    }
+    ssize_t read( int fd, void* buf, size_t bytes ) {
+        count();
+        static auto real = next<ssize_t( int, void*, size_t )>( "read" );
+        return real( fd, buf, readLimit ? std::min( bytes, readLimit ) : bytes );
+    }
+    int close( int fd ) {
+        count();
+        static auto real = next<int( int )>( "close" );
+        return real( fd );
+    }
+    int fstat( int fd, struct stat* st ) {
+        count();
+        static auto real = next<int( int, struct stat* )>( "fstat" );
+        return real( fd, st );
+    }
+    int fstat64( int fd, struct stat64* st ) {
+        count();
+        static auto real = next<int( int, struct stat64* )>( "fstat64" );
+        return real( fd, st );
+    }
+}
+
+//! \returns syscalls needed to read all files
+size_t countSyscalls( const std::vector<sys_string>& files, const std::string& content, const size_t sizeHint = 0 ) {
+    utils::ReadOptions options;
+    options.sizeHint = sizeHint;
+    syscalls = 0;
+    counting = true;
+
+    for( const sys_string& file : files ) {
+        utils::FileView view = utils::fromFileP( file, options );
+        BOOST_CHECK_EQUAL( view.content.size(), content.size() );
+    }
+
+    counting = false;
+    return syscalls;
+}
+
+BOOST_AUTO_TEST_CASE( Test_smallFiles ) {
+    fs::path dir = fs::temp_directory_path( ) / "test_syscalls_small";
+    fs::remove_all( dir );
+
+    std::string content = "hase\n";
+    std::vector<sys_string> files;
+
+    // 10 dirs with 100 files each
+    for( size_t i = 0; i < 10; ++i ) {
+        fs::path sub = dir / utils::format( "dir%02d", i );
+        BOOST_REQUIRE( fs::create_directories( sub ) );
+
+        for( size_t j = 0; j < 100; ++j ) {
+            fs::path file = sub / utils::format( "test%02d.cpp", j );
+            boost::filesystem::ofstream( file ) << content;
+            files.emplace_back( file.native() );
+        }
+    }
+
+    size_t calls = countSyscalls( files, content );
+    double perFile = double( calls ) / files.size();
+    printf( "Small files : %.2f syscalls per file\n", perFile );
+    BOOST_CHECK_LE( perFile, BUDGET_SMALL );
+
+    fs::remove_all( dir );
+}
+
+BOOST_AUTO_TEST_CASE( Test_largeFiles ) {
+    fs::path dir = fs::temp_directory_path( ) / "test_syscalls_large";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir ) );
+
+    // larger than the first optimistic read
+    std::string content( 200_kB, 'a' );
+    std::vector<sys_string> files;
+
+    for( size_t i = 0; i < 10; ++i ) {
+        fs::path file = dir / utils::format( "test%02d.txt", i );
+        boost::filesystem::ofstream( file ) << content;
+        files.emplace_back( file.native() );
+    }
+
+    size_t calls = countSyscalls( files, content );
+    double perFile = double( calls ) / files.size();
+    printf( "Large files : %.2f syscalls per file\n", perFile );
+    BOOST_CHECK_LE( perFile, BUDGET_LARGE );
+
+    calls = countSyscalls( files, content, content.size() );
+    perFile = double( calls ) / files.size();
+    printf( "Size hinted : %.2f syscalls per file\n", perFile );
+    BOOST_CHECK_LE( perFile, BUDGET_HINTED );
+
+    // stale hints still read the whole file
+    countSyscalls( files, content, content.size() / 2 );
+    countSyscalls( files, content, content.size() * 2 );
+
+    // short reads behind the first block are continued, with and without hint
+    readLimit = 64_kB;
+    countSyscalls( files, content );
+    countSyscalls( files, content, content.size() );
+    readLimit = 0;
+
+    fs::remove_all( dir );
+}
+
+#else
+
+BOOST_AUTO_TEST_CASE( Test_Syscalls ) {
+    // syscalls are counted on Linux only
+    BOOST_CHECK( true );
+}
+
+#endif
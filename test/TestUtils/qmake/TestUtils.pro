@@ -3,6 +3,7 @@ CONFIG += static
 MAIN_DIR=../../..
 PRI_DIR=$${MAIN_DIR}/qmake
 
+include( $${PRI_DIR}/options.pri )
 include( $${PRI_DIR}/setup.pri )
 linux: include( $${PRI_DIR}/linux.pri )
 win32: include( $${PRI_DIR}/win.pri )
@@ -18,6 +19,30 @@ SRC_DIR=$${MAIN_DIR}/src
 INCLUDEPATH += $${SRC_DIR}
 HEADERS += $${SRC_DIR}/utils.hpp
 SOURCES += $${SRC_DIR}/utils.cpp
+HEADERS += $${SRC_DIR}/encoding.hpp
+SOURCES += $${SRC_DIR}/encoding.cpp
+HEADERS += $${SRC_DIR}/compression.hpp
+SOURCES += $${SRC_DIR}/compression.cpp
+HEADERS += $${SRC_DIR}/archive.hpp
+SOURCES += $${SRC_DIR}/archive.cpp
+HEADERS += $${SRC_DIR}/glob.hpp
+SOURCES += $${SRC_DIR}/glob.cpp
+HEADERS += $${SRC_DIR}/gitignore.hpp
+SOURCES += $${SRC_DIR}/gitignore.cpp
+HEADERS += $${SRC_DIR}/filter.hpp
+SOURCES += $${SRC_DIR}/filter.cpp
+HEADERS += $${SRC_DIR}/dedup.hpp
+SOURCES += $${SRC_DIR}/dedup.cpp
+HEADERS += $${SRC_DIR}/pipeline.hpp
+SOURCES += $${SRC_DIR}/pipeline.cpp
+HEADERS += $${SRC_DIR}/gitindex.hpp
+SOURCES += $${SRC_DIR}/gitindex.cpp
+HEADERS += $${SRC_DIR}/gitobjects.hpp
+SOURCES += $${SRC_DIR}/gitobjects.cpp
 HEADERS += $${SRC_DIR}/pipes.hpp
 SOURCES += $${SRC_DIR}/pipes.cpp
+HEADERS += $${SRC_DIR}/searcher.hpp
+SOURCES += $${SRC_DIR}/searcher.cpp
+HEADERS += $${SRC_DIR}/threadpool.hpp
+SOURCES += $${SRC_DIR}/threadpool.cpp
 macx: SOURCES += $${SRC_DIR}/macutils.mm
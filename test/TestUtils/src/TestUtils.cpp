@@ -3,7 +3,26 @@
 #include <boost/test/unit_test.hpp>
 
 #include "utils.hpp"
+#include "archive.hpp"
+#include "compression.hpp"
+#include "ssefind.hpp"
+#include "glob.hpp"
+#include "gitignore.hpp"
+#include "filter.hpp"
+#include "dedup.hpp"
+#include "pipeline.hpp"
+#include "gitindex.hpp"
+#include "gitobjects.hpp"
+#include "searcher.hpp"
+#include "printer/printer.hpp"
 #include <fstream>
+#include <map>
+#include <set>
+#include <thread>
+
+#include "boost/iostreams/filtering_stream.hpp"
+#include "boost/iostreams/filter/gzip.hpp"
+#include "boost/iostreams/filter/zlib.hpp"
 
 BOOST_AUTO_TEST_CASE( Test_isTextFile ) {
 
@@ -15,6 +34,94 @@ BOOST_AUTO_TEST_CASE( Test_isTextFile ) {
 
     std::string_view text( "Text File\n", 10 );
     BOOST_CHECK( utils::isTextFile( text ) );
+
+    std::string_view single( "Text\0File\n", 11 );
+    BOOST_CHECK( !utils::isTextFile( single ) );
+}
+
+BOOST_AUTO_TEST_CASE( Test_classify ) {
+    using encoding::Encoding;
+
+    BOOST_CHECK( encoding::classify( "plain ascii text\n" ) == Encoding::UTF8 );
+    BOOST_CHECK( encoding::classify( "gr\xC3\xBC\xC3\x9F dich\n" ) == Encoding::UTF8 );
+    BOOST_CHECK( encoding::classify( "gr\xFC\xDF dich\n" ) == Encoding::Latin1 );
+    BOOST_CHECK( encoding::classify( "\x7F" "ELF" ) == Encoding::Binary );
+
+    std::string_view bom( "\xFF\xFEh\0a\0s\0e\0", 10 );
+    BOOST_CHECK( encoding::classify( bom ) == Encoding::UTF16LE );
+
+    std::string_view le( "h\0a\0s\0e\0\n\0", 10 );
+    BOOST_CHECK( encoding::classify( le ) == Encoding::UTF16LE );
+
+    std::string_view be( "\0h\0a\0s\0e\0\n", 10 );
+    BOOST_CHECK( encoding::classify( be ) == Encoding::UTF16BE );
+
+    // control chars
+    std::string controls( 100, '\x01' );
+    BOOST_CHECK( encoding::classify( controls ) == Encoding::Binary );
+
+    // overlong and surrogates
+    BOOST_CHECK( !encoding::isUTF8( "\xC0\xAF", 2 ) );
+    BOOST_CHECK( !encoding::isUTF8( "\xED\xA0\x80", 3 ) );
+    BOOST_CHECK( encoding::isUTF8( "\xE2\x82", 2, true ) );
+
+    // long ASCII runs are skipped with sse
+    std::string longText( 1000, 'a' );
+    longText += "\xE2\x82\xAC";
+    BOOST_CHECK( encoding::isUTF8( longText.data(), longText.size() ) );
+}
+
+BOOST_AUTO_TEST_CASE( Test_transcode ) {
+    using encoding::Encoding;
+    char out[256] = {};
+
+    // BOM is dropped, long ASCII runs take the sse path
+    std::string ascii = "0123456789abcdefghijklmnopqrstuv\n";
+    std::string le = "\xFF\xFE";
+
+    for( char c : ascii ) { le.push_back( c ); le.push_back( '\0' ); }
+
+    size_t size = encoding::toUTF8( Encoding::UTF16LE, le.data(), le.size(), out );
+    BOOST_CHECK_EQUAL( std::string( out, size ), ascii );
+
+    // U+00FC and U+1F600 as surrogate pair
+    std::string_view be( "\x00\xFC\xD8\x3D\xDE\x00", 6 );
+    size = encoding::toUTF8( Encoding::UTF16BE, be.data(), be.size(), out );
+    BOOST_CHECK_EQUAL( std::string( out, size ), "\xC3\xBC\xF0\x9F\x98\x80" );
+
+    // unpaired surrogate
+    std::string_view unpaired( "\x3D\xD8" "a\0", 4 );
+    size = encoding::toUTF8( Encoding::UTF16LE, unpaired.data(), unpaired.size(), out );
+    BOOST_CHECK_EQUAL( std::string( out, size ), "\xEF\xBF\xBD" "a" );
+
+    std::string_view latin1( "Gr\xFC\xDF" );
+    size = encoding::toUTF8( Encoding::Latin1, latin1.data(), latin1.size(), out );
+    BOOST_CHECK_EQUAL( std::string( out, size ), "Gr\xC3\xBC\xC3\x9F" );
+}
+
+BOOST_AUTO_TEST_CASE( Test_Buffer ) {
+    utils::Buffer buffer;
+    BOOST_CHECK( !buffer.huge );
+
+    char* ptr = buffer.grow( 10_MB );
+    BOOST_CHECK_EQUAL( buffer.size, 10_MB );
+    BOOST_CHECK( buffer.reserved >= 10_MB );
+
+    // padding for sse must be zeroed
+    BOOST_CHECK_EQUAL( ptr[10_MB], '\0' );
+
+    if( buffer.huge ) {
+        BOOST_CHECK_EQUAL( reinterpret_cast<uintptr_t>( ptr ) % utils::Buffer::hugePageSize, 0 );
+    }
+
+    // failed allocations leave extend's buffer untouched, and grow's empty but usable
+    memcpy( ptr, "hase", 4 );
+    buffer.size = 4;
+    BOOST_CHECK( !buffer.extend( 1ull << 62 ) );
+    BOOST_CHECK_EQUAL( std::string( buffer.ptr, buffer.size ), "hase" );
+    BOOST_CHECK( !buffer.grow( 1ull << 62 ) );
+    BOOST_CHECK_EQUAL( buffer.size, 0 );
+    BOOST_CHECK( buffer.grow( 1_kB ) );
 }
 
 BOOST_AUTO_TEST_CASE( Test_printFunc ) {
@@ -69,28 +176,857 @@ BOOST_AUTO_TEST_CASE( Test_recurseDir ) {
     BOOST_CHECK_EQUAL( counter, 1 );
 }
 
+BOOST_AUTO_TEST_CASE( Test_listDir ) {
+
+    fs::path dir = fs::temp_directory_path( ) / "test_listDir";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir / "sub" ) );
+    BOOST_REQUIRE( fs::create_directories( dir / ".git" ) );
+
+    // more entries than fit into one getdents64 call of readdir
+    for( size_t i = 0; i < 2000; ++i ) {
+        boost::filesystem::ofstream( dir / utils::format( "test_with_a_long_name_%04d.txt", i ) ) << "hase";
+    }
+
+    boost::filesystem::ofstream( dir / ".git" / "config" ) << "hase";
+
+    size_t files = 0;
+    size_t inodes = 0;
+    std::vector<sys_string> dirs;
+    const bool repo = utils::listDir( dir.native(), [&]( const sys_string & filename ) {
+        ++files;
+        // the inode of the directory entry comes without a stat
+        uint64_t dev = 0;
+        uint64_t ino = 0;
+
+        if( utils::fileId( filename, dev, ino ) && ino == utils::listedInode ) { ++inodes; }
+    }, [&]( const sys_string & dirname ) {
+        dirs.push_back( dirname );
+    } );
+
+    BOOST_CHECK( repo );
+    BOOST_CHECK_EQUAL( files, 2000 );
+#ifndef _WIN32
+    BOOST_CHECK_EQUAL( inodes, 2000 );
+#endif
+    BOOST_REQUIRE_EQUAL( dirs.size(), 1 );
+    BOOST_CHECK( fs::path( dirs.front() ).filename() == "sub" );
+
+    // subdirectories are listed after their parent
+    BOOST_REQUIRE( fs::create_directories( dir / "sub" / "deeper" ) );
+    boost::filesystem::ofstream( dir / "sub" / "deeper" / "test.txt" ) << "hase";
+    files = 0;
+    utils::recurseDir( dir.native(), [&]( const sys_string& ) { ++files; } );
+    BOOST_CHECK_EQUAL( files, 2001 );
+
+    fs::remove_all( dir );
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE( Test_links ) {
+
+    fs::path dir = fs::temp_directory_path( ) / "test_links";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir / "src" / "sub" ) );
+    boost::filesystem::ofstream( dir / "src" / "a.txt" ) << "hase";
+    boost::filesystem::ofstream( dir / "src" / "sub" / "b.txt" ) << "hase";
+    fs::create_directory_symlink( "src", dir / "farm" );
+    fs::create_symlink( "src/a.txt", dir / "a.txt" );
+    fs::create_directory_symlink( "..", dir / "src" / "sub" / "up" );
+    fs::create_symlink( "missing", dir / "dangling" );
+
+    // links are skipped by default
+    std::vector<sys_string> files;
+    utils::recurseDir( dir.native(), [&]( const sys_string & filename ) { files.push_back( filename ); } );
+    BOOST_CHECK_EQUAL( files.size(), 2 );
+
+    // each directory is listed once, the cycle through up is broken
+    utils::Links::follow = true;
+    utils::Links::clear();
+    files.clear();
+    utils::recurseDir( dir.native(), [&]( const sys_string & filename ) { files.push_back( filename ); } );
+    BOOST_CHECK_EQUAL( files.size(), 3 );
+
+    // the file behind both names is visited once
+    size_t visited = 0;
+
+    for( const sys_string& filename : files ) { visited += utils::Links::visit( filename ); }
+
+    BOOST_CHECK_EQUAL( visited, 2 );
+
+    utils::Links::follow = false;
+    utils::Links::clear();
+    fs::remove_all( dir );
+}
+#endif
+
+BOOST_AUTO_TEST_CASE( Test_cpuCount ) {
+    // affinity and cgroup quota only lower the count
+    const size_t cpus = utils::cpuCount();
+    BOOST_CHECK_GE( cpus, 1 );
+    BOOST_CHECK_LE( cpus, std::max( std::thread::hardware_concurrency(), 1u ) );
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE( Test_cpuOrder ) {
+    // each CPU of the affinity mask once, no matter the nodes
+    const std::vector<int> order = utils::cpuOrder();
+    cpu_set_t set;
+    BOOST_REQUIRE_EQUAL( sched_getaffinity( 0, sizeof( set ), &set ), 0 );
+    BOOST_CHECK_EQUAL( order.size(), CPU_COUNT( &set ) );
+    BOOST_CHECK_EQUAL( std::set<int>( order.cbegin(), order.cend() ).size(), order.size() );
+
+    for( const int cpu : order ) { BOOST_CHECK( CPU_ISSET( cpu, &set ) ); }
+}
+#endif
+
+BOOST_AUTO_TEST_CASE( Test_decompress ) {
+
+    fs::path dir = fs::temp_directory_path( ) / "test_decompress";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir ) );
+
+    fs::path test = dir / "test.txt.gz";
+    std::string content( 100_kB, 'a' );
+    content += "hase\n";
+
+    {
+        boost::filesystem::ofstream file( test, std::ios::binary );
+        boost::iostreams::filtering_ostream out;
+        out.push( boost::iostreams::gzip_compressor() );
+        out.push( file );
+        out << content;
+    }
+
+    // compressed files are binaries by default
+    utils::FileView view = utils::fromFileP( test.native() );
+    BOOST_CHECK_EQUAL( view.size, 0 );
+
+    utils::ReadOptions options;
+    options.decompress = true;
+    view = utils::fromFileP( test.native(), options );
+    BOOST_CHECK_EQUAL( std::string( view.content ), content );
+
+    // deferred reads leave the content compressed in the given buffer, until finish
+    utils::Buffer buffer;
+    options.deferred = true;
+    view = utils::fromFileP( test.native(), options, buffer );
+    BOOST_CHECK( view.compressed );
+    BOOST_CHECK_EQUAL( view.content.data(), buffer.ptr );
+    BOOST_REQUIRE( utils::finish( view, options ) );
+    BOOST_CHECK_EQUAL( std::string( view.content ), content );
+    BOOST_CHECK( utils::finish( view, options ) );
+
+    // streams append the output piece by piece
+    const utils::MappedFile file( test );
+    compression::Stream stream( compression::Format::Gzip, file.content() );
+    utils::Buffer out;
+    out.size = 0;
+    BOOST_REQUIRE( stream.read( out, 1_kB ) );
+    BOOST_CHECK_EQUAL( out.size, 1_kB );
+    BOOST_CHECK( !stream.finished() );
+    BOOST_REQUIRE( stream.read( out, 1_MB ) );
+    BOOST_CHECK( stream.finished() );
+    BOOST_CHECK_EQUAL( std::string( out.ptr, out.size ), content );
+
+    fs::remove_all( dir );
+}
+
+BOOST_AUTO_TEST_CASE( Test_nowait ) {
+
+    fs::path dir = fs::temp_directory_path( ) / "test_nowait";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir ) );
+
+    fs::path test = dir / "test.txt";
+    std::string content( 100_kB, 'a' );
+    content += "hase\n";
+    {
+        boost::filesystem::ofstream file( test, std::ios::binary );
+        file << content;
+    }
+
+    // a file just written is in the page cache, so it is read completely
+    utils::ReadOptions options;
+    options.nowait = true;
+    utils::FileView view = utils::fromFileP( test.native(), options );
+    BOOST_CHECK( !view.uncached );
+    BOOST_CHECK_EQUAL( std::string( view.content ), content );
+
+    fs::remove_all( dir );
+}
+
+BOOST_AUTO_TEST_CASE( Test_pipeline ) {
+    // the producer waits for the consumer, once all slots are in use
+    pipeline::Slots<std::string> slots( 2 );
+    std::string* first = slots.acquire();
+    std::string* second = slots.acquire();
+    BOOST_CHECK_NE( first, second );
+
+    std::atomic_bool waited = {false};
+    std::thread consumer( [&] {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+        waited = true;
+        slots.release( first );
+    } );
+
+    std::string* third = slots.acquire();
+    BOOST_CHECK( waited );
+    BOOST_CHECK_EQUAL( third, first );
+    consumer.join();
+
+    slots.release( second );
+    slots.release( third );
+    slots.drain();
+}
+
+//! \returns tar header block for a member of type with name and size
+std::string tarHeader( const std::string& name, const size_t size, const char type ) {
+    std::string header( 512, '\0' );
+    header.replace( 0, name.size(), name );
+    header.replace( 124, 11, utils::format( "%011lo", size ) );
+    header[156] = type;
+    header.replace( 257, 6, std::string( "ustar\0", 6 ) );
+    return header;
+}
+
+//! \returns content padded to full tar blocks
+std::string tarData( const std::string& content ) {
+    return content + std::string( ( 512 - content.size() % 512 ) % 512, '\0' );
+}
+
+//! \returns little endian bytes of value
+template<class T>
+std::string le( const T value ) {
+    return std::string( reinterpret_cast<const char*>( &value ), sizeof( T ) );
+}
+
+BOOST_AUTO_TEST_CASE( Test_archive ) {
+
+    const std::string longName = std::string( 150, 'd' ) + "/long.txt";
+    std::map<std::string, std::string> expected = {
+        { "dir/short.txt", "hase\n" },
+        { longName, std::string( 1000, 'a' ) + "igel\n" },
+    };
+
+    // tar with a GNU long name
+    std::string tar = tarHeader( "dir/short.txt", 5, '0' ) + tarData( "hase\n" );
+    tar += tarHeader( "dir/", 0, '5' );
+    tar += tarHeader( "././@LongLink", longName.size(), 'L' ) + tarData( longName );
+    tar += tarHeader( "truncated", expected[longName].size(), '0' ) + tarData( expected[longName] );
+    tar += std::string( 1024, '\0' );
+    BOOST_CHECK( archive::detect( tar ) == archive::Format::Tar );
+
+    std::map<std::string, std::string> members;
+    utils::Buffer buffer;
+    auto collect = [&members]( const std::string & name, const std::string_view & member ) {
+        members[name] = member;
+    };
+
+    BOOST_CHECK( archive::walk( tar, buffer, collect ) );
+    BOOST_CHECK( members == expected );
+
+    // zip with a stored and a deflated entry
+    std::string zip, directory;
+    uint16_t method = 0;
+
+    for( const auto& [name, content] : expected ) {
+        std::string data = content;
+
+        if( method == 8 ) {
+            data.clear();
+            boost::iostreams::zlib_params params;
+            params.noheader = true;
+            boost::iostreams::filtering_ostream out;
+            out.push( boost::iostreams::zlib_compressor( params ) );
+            out.push( boost::iostreams::back_inserter( data ) );
+            out << content;
+            out.reset();
+        }
+
+        const uint32_t offset = zip.size();
+        const std::string sizes = le<uint32_t>( 0 ) + le<uint32_t>( data.size() ) + le<uint32_t>( content.size() );
+        zip += "PK\x03\x04" + le<uint16_t>( 20 ) + le<uint16_t>( 0 ) + le<uint16_t>( method ) + le<uint32_t>( 0 ) + sizes;
+        zip += le<uint16_t>( name.size() ) + le<uint16_t>( 0 ) + name + data;
+        directory += "PK\x01\x02" + le<uint16_t>( 20 ) + le<uint16_t>( 20 ) + le<uint16_t>( 0 ) + le<uint16_t>( method ) + le<uint32_t>( 0 ) + sizes;
+        directory += le<uint16_t>( name.size() ) + std::string( 12, '\0' ) + le<uint32_t>( offset ) + name;
+        method = 8;
+    }
+
+    const uint32_t offset = zip.size();
+    zip += directory;
+    zip += "PK\x05\x06" + std::string( 4, '\0' ) + le<uint16_t>( 2 ) + le<uint16_t>( 2 );
+    zip += le<uint32_t>( directory.size() ) + le<uint32_t>( offset ) + le<uint16_t>( 0 );
+    BOOST_CHECK( archive::detect( zip ) == archive::Format::Zip );
+
+    members.clear();
+    BOOST_CHECK( archive::walk( zip, buffer, collect ) );
+    BOOST_CHECK( members == expected );
+
+    // corrupt archives
+    BOOST_CHECK( !archive::walk( zip.substr( 0, zip.size() - 1 ), buffer, collect ) );
+    BOOST_CHECK( !archive::walk( tar.substr( 0, 3584 ), buffer, collect ) );
+
+    // archives are binaries by default
+    fs::path dir = fs::temp_directory_path( ) / "test_archive";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir ) );
+    fs::path test = dir / "test.zip";
+    boost::filesystem::ofstream( test, std::ios::binary ) << zip;
+
+    utils::FileView view = utils::fromFileP( test.native() );
+    BOOST_CHECK_EQUAL( view.size, 0 );
+
+    utils::ReadOptions options;
+    options.archives = true;
+    view = utils::fromFileP( test.native(), options );
+    BOOST_CHECK( view.archive );
+    BOOST_CHECK_EQUAL( std::string( view.content ), zip );
+}
+
+BOOST_AUTO_TEST_CASE( Test_binary ) {
+
+    fs::path dir = fs::temp_directory_path( ) / "test_binary";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir ) );
+
+    fs::path test = dir / "test.bin";
+    std::string content( "\x7F" "ELF\0\0\xDE\xAD\xBE\xEF\0", 11 );
+    boost::filesystem::ofstream( test, std::ios::binary ) << content;
+
+    // binaries are skipped by default
+    utils::FileView view = utils::fromFileP( test.native() );
+    BOOST_CHECK_EQUAL( view.size, 0 );
+
+    utils::ReadOptions options;
+    options.binary = true;
+    view = utils::fromFileP( test.native(), options );
+    BOOST_CHECK_EQUAL( std::string( view.content ), content );
+
+    // terms with \0 don't match the zero padding
+    BOOST_CHECK_EQUAL( sse::find( view.content, std::string( "\xEF\0", 2 ) ).size(), 1 );
+    BOOST_CHECK_EQUAL( sse::find( view.content, std::string( "\xEF\0\0", 3 ) ).size(), 0 );
+
+    // first char at the end of a block without the second behind it
+    std::string text( 15, 'a' );
+    text += "bxb";
+    utils::Buffer buffer;
+    memcpy( buffer.grow( text.size() ), text.data(), text.size() );
+    BOOST_CHECK_EQUAL( sse::find( std::string_view( buffer.ptr, buffer.size ), "bc" ).size(), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( Test_glob ) {
+
+    BOOST_CHECK( glob::match( "*.cpp", "utils.cpp" ) );
+    BOOST_CHECK( !glob::match( "*.cpp", "src/utils.cpp" ) );
+    BOOST_CHECK( !glob::match( "*.cpp", "utils.hpp" ) );
+    BOOST_CHECK( glob::match( "utils.?pp", "utils.hpp" ) );
+    BOOST_CHECK( glob::match( "[a-c]x[!0-9]", "bxy" ) );
+    BOOST_CHECK( !glob::match( "[a-c]x[!0-9]", "bx1" ) );
+    BOOST_CHECK( glob::match( "[[:digit:]]*", "1abc" ) );
+    BOOST_CHECK( glob::match( "\\*", "*" ) );
+    BOOST_CHECK( !glob::match( "\\*", "a" ) );
+
+    // ** matches zero or more directories
+    BOOST_CHECK( glob::match( "**/test", "test" ) );
+    BOOST_CHECK( glob::match( "**/test", "a/b/test" ) );
+    BOOST_CHECK( glob::match( "a/**/b", "a/b" ) );
+    BOOST_CHECK( glob::match( "a/**/b", "a/x/y/b" ) );
+    BOOST_CHECK( glob::match( "a/**", "a/x/y" ) );
+    BOOST_CHECK( !glob::match( "a/**", "b/x" ) );
+}
+
+BOOST_AUTO_TEST_CASE( Test_gitignore ) {
+
+    auto rules = std::make_shared<gitignore::Rules>();
+    rules->patterns = gitignore::parse( "# comment\n*.o\nbuild/\n/root.txt\ndoc/*.html\n!keep.o\n\\#hash\n" );
+    BOOST_CHECK_EQUAL( rules->patterns.size(), 6 );
+
+    BOOST_CHECK( rules->ignored( "main.o", false ) );
+    BOOST_CHECK( rules->ignored( "src/main.o", false ) );
+    BOOST_CHECK( !rules->ignored( "keep.o", false ) );
+    BOOST_CHECK( rules->ignored( "src/build", true ) );
+    BOOST_CHECK( !rules->ignored( "src/build", false ) );
+    BOOST_CHECK( rules->ignored( "root.txt", false ) );
+    BOOST_CHECK( !rules->ignored( "src/root.txt", false ) );
+    BOOST_CHECK( rules->ignored( "doc/index.html", false ) );
+    BOOST_CHECK( !rules->ignored( "doc/api/index.html", false ) );
+    BOOST_CHECK( rules->ignored( "#hash", false ) );
+
+    // deeper ignore files win, and apply to their own directory only
+    auto sub = std::make_shared<gitignore::Rules>();
+    sub->parent = rules;
+    sub->base = "src/";
+    sub->patterns = gitignore::parse( "!*.o\n/gen\n" );
+    BOOST_CHECK( !sub->ignored( "src/main.o", false ) );
+    BOOST_CHECK( sub->ignored( "lib/main.o", false ) );
+    BOOST_CHECK( sub->ignored( "src/gen", false ) );
+    BOOST_CHECK( !sub->ignored( "gen", false ) );
+
+    // walk with .gitignore files
+    fs::path dir = fs::temp_directory_path( ) / "test_gitignore";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir / "src" / "build" ) );
+    boost::filesystem::ofstream( dir / ".gitignore" ) << "*.o\nbuild/\n";
+    boost::filesystem::ofstream( dir / "src" / ".gitignore" ) << "!keep.o\n";
+    boost::filesystem::ofstream( dir / "src" / "main.cpp" ) << "hase";
+    boost::filesystem::ofstream( dir / "src" / "main.o" ) << "hase";
+    boost::filesystem::ofstream( dir / "src" / "keep.o" ) << "hase";
+    boost::filesystem::ofstream( dir / "src" / "build" / "out.txt" ) << "hase";
+
+    struct {
+        void add( const std::function<void()>& job ) { job(); }
+    } pool;
+
+    std::set<std::string> files;
+    const sys_string root = dir.native();
+    size_t listed = 0;
+    gitignore::recurseDirParallel( pool, root, root.size() + 1, nullptr, [&]( const sys_string & filename ) {
+        files.insert( gitignore::relative( filename, root.size() + 1 ) );
+    }, nullptr, nullptr, [&] { listed++; } );
+
+    std::set<std::string> expected = { ".gitignore", "src/.gitignore", "src/main.cpp", "src/keep.o" };
+    BOOST_CHECK( files == expected );
+    // once per walked directory, the ignored build is not listed
+    BOOST_CHECK_EQUAL( listed, 2 );
+
+    // nested repos and submodules with a .git file are handed to onRepo instead of walked
+    BOOST_REQUIRE( fs::create_directories( dir / "nested" / ".git" ) );
+    BOOST_REQUIRE( fs::create_directories( dir / "module" ) );
+    boost::filesystem::ofstream( dir / "nested" / "file.txt" ) << "hase";
+    boost::filesystem::ofstream( dir / "module" / ".git" ) << "gitdir: ../.git/modules/module\n";
+    boost::filesystem::ofstream( dir / "module" / "file.txt" ) << "hase";
+
+    files.clear();
+    std::set<std::string> repos;
+    gitignore::recurseDirParallel( pool, root, root.size() + 1, nullptr, [&]( const sys_string & filename ) {
+        files.insert( gitignore::relative( filename, root.size() + 1 ) );
+    }, [&]( const sys_string & dirname ) {
+        repos.insert( fs::path( dirname ).filename().string() );
+    } );
+
+    BOOST_CHECK( files == expected );
+    BOOST_CHECK( repos == std::set<std::string>( { "nested", "module" } ) );
+
+    fs::remove_all( dir );
+}
+
+BOOST_AUTO_TEST_CASE( Test_filter ) {
+
+    BOOST_CHECK( !filter::compile( {}, {}, {}, "/src" ) );
+
+    // names, suffixes and globs are matched from their own tables
+    auto filter = filter::compile( { "*.cpp", "CMakeLists.txt", "src/**/*.h", "!*.min.js", "!node_modules", "!build/" }, {}, {}, "/src" );
+    BOOST_REQUIRE( filter );
+    BOOST_CHECK( filter->file( "main.cpp" ) );
+    BOOST_CHECK( filter->file( "lib/main.cpp" ) );
+    BOOST_CHECK( filter->file( "lib/CMakeLists.txt" ) );
+    BOOST_CHECK( filter->file( "src/a/b/main.h" ) );
+    BOOST_CHECK( !filter->file( "lib/main.h" ) );
+    BOOST_CHECK( !filter->file( "main.hpp" ) );
+
+    // excluded directories are pruned, files below them are skipped, if they were not walked
+    BOOST_CHECK( filter->dir( "src" ) );
+    BOOST_CHECK( !filter->dir( "web/node_modules" ) );
+    BOOST_CHECK( !filter->dir( "build" ) );
+    BOOST_CHECK( filter->file( "node_modules/x/main.cpp" ) );
+    BOOST_CHECK( !filter->file( "node_modules/x/main.cpp", true ) );
+    BOOST_CHECK( filter->listedDir( "/src/lib" ) );
+    BOOST_CHECK( !filter->listedDir( "/src/lib/node_modules" ) );
+    BOOST_CHECK( filter->listedFile( "/src/lib/main.cpp" ) );
+
+    // types include and exclude files only, excludes win
+    filter = filter::compile( { "!*.min.js" }, { "js", "cpp" }, { "c" }, "/src/" );
+    BOOST_REQUIRE( filter );
+    BOOST_CHECK( filter->root == 5 );
+    BOOST_CHECK( filter->file( "app.js" ) );
+    BOOST_CHECK( !filter->file( "app.min.js" ) );
+    BOOST_CHECK( filter->file( "main.cpp" ) );
+    BOOST_CHECK( !filter->file( "main.h" ) );
+    BOOST_CHECK( !filter->file( "README.md" ) );
+    BOOST_CHECK( filter->dir( "lib.js" ) );
+
+    BOOST_CHECK( filter::isType( "cpp" ) );
+    BOOST_CHECK( !filter::isType( "hase" ) );
+    BOOST_CHECK( filter::typeList().find( "cpp: *.cpp, " ) != std::string::npos );
+}
+
+BOOST_AUTO_TEST_CASE( Test_dedup ) {
+
+    dedup::Index index;
+    const std::string content = "hase\nigel hase\n";
+    const std::string copy = content;
+    bool first = false;
+
+    dedup::ResultPtr result = index.byContent( content, 1, 2, first );
+    BOOST_REQUIRE( result );
+    BOOST_CHECK( first );
+    BOOST_CHECK( !result->done );
+
+    // matches are stored as offsets, so they apply to copies
+    const std::string_view view( content );
+    result->set( { { view.cbegin() + 10, view.cbegin() + 14 } }, view, false );
+    BOOST_CHECK( result->done );
+
+    BOOST_CHECK( index.byContent( copy, 3, 4, first ) == result );
+    BOOST_CHECK( !first );
+    BOOST_CHECK_EQUAL( result->content, content );
+    const std::vector<search::Match> matches = result->get( copy );
+    BOOST_REQUIRE_EQUAL( matches.size(), 1 );
+    BOOST_CHECK( std::string( matches.front().first, matches.front().second ) == "hase" );
+    BOOST_CHECK( &*matches.front().first == copy.data() + 10 );
+
+    // hardlinks are found without reading them
+    BOOST_CHECK( index.byInode( 1, 2 ) == result );
+    BOOST_CHECK( index.byInode( 3, 4 ) == result );
+    BOOST_CHECK( !index.byInode( 5, 6 ) );
+
+    BOOST_CHECK( index.byContent( "igel", 0, 0, first ) != result );
+    BOOST_CHECK( first );
+    BOOST_CHECK( !index.byInode( 0, 0 ) );
+
+    // same size, different bytes
+    std::string other = content;
+    other[0] = 'H';
+    BOOST_CHECK( index.byContent( other, 0, 0, first ) != result );
+    BOOST_CHECK( first );
+
+    // contents beyond the kept bytes are not deduplicated
+    const std::string large( dedup::Index::maxKept, 'a' );
+    BOOST_CHECK( !index.byContent( large, 0, 0, first ) );
+    BOOST_CHECK( !first );
+}
+
+BOOST_AUTO_TEST_CASE( Test_gitindex ) {
+
+    // big endian numbers
+    auto be = []( std::string & out, const uint64_t value, const size_t bytes ) {
+        for( size_t i = bytes; i > 0; --i ) { out.push_back( char( value >> ( 8 * ( i - 1 ) ) ) ); }
+    };
+
+    // index with entries in version 2 or 4, where v4 strips the common prefix
+    auto index = [&be]( const uint32_t version, const std::vector<std::pair<std::string, uint32_t>>& entries, const std::string & extensions ) {
+        std::string out = "DIRC";
+        be( out, version, 4 );
+        be( out, entries.size(), 4 );
+        std::string last;
+
+        for( const auto& [path, mode] : entries ) {
+            const size_t start = out.size();
+
+            for( uint32_t i = 0; i < 10; ++i ) { be( out, i == 6 ? mode : i == 9 ? path.size() : 0, 4 ); }
+
+            out.append( 20, '\x11' );
+            be( out, std::min<size_t>( path.size(), 0xFFF ), 2 );
+
+            if( version == 4 ) {
+                size_t common = 0;
+
+                while( common < last.size() && common < path.size() && last[common] == path[common] ) { ++common; }
+
+                out.push_back( char( last.size() - common ) );
+                out += path.substr( common ) + '\0';
+            } else {
+                out += path;
+                out.append( 8 - ( out.size() - start ) % 8, '\0' );
+            }
+
+            last = path;
+        }
+
+        return out + extensions + std::string( 20, '\0' );
+    };
+
+    fs::path dir = fs::temp_directory_path( ) / "test_gitindex";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir ) );
+
+    auto read = [&dir]() {
+        std::map<std::string, uint32_t> files;
+        const bool ok = gitindex::read( dir, [&files]( const gitindex::Entry & entry ) {
+            BOOST_CHECK( !files.count( entry.path ) );
+            files[entry.path] = entry.size;
+            BOOST_CHECK_EQUAL( entry.isGitlink(), entry.path == "sub" );
+        } );
+        BOOST_CHECK( ok );
+        return files;
+    };
+
+    const std::vector<std::pair<std::string, uint32_t>> entries = {
+        { "README.md", 0100644 }, { "src/main.cpp", 0100644 }, { "src/main.hpp", 0100755 }, { "sub", 0160000 }
+    };
+    const std::map<std::string, uint32_t> expected = {
+        { "README.md", 9 }, { "src/main.cpp", 12 }, { "src/main.hpp", 12 }, { "sub", 3 }
+    };
+
+    for( const uint32_t version : { 2, 4 } ) {
+        boost::filesystem::ofstream( dir / "index", std::ios::binary ) << index( version, entries, "" );
+        BOOST_CHECK( read() == expected );
+    }
+
+    // split index deletes src/main.cpp from the shared index, replaces README.md and adds new.txt
+    const std::string shared( 40, 'a' );
+    boost::filesystem::ofstream( dir / ( "sharedindex." + shared ), std::ios::binary ) << index( 2, entries, "" );
+
+    std::string link;
+    link.append( 20, '\xaa' );
+    be( link, 4, 4 );         // deleted: 4 bits
+    be( link, 2, 4 );         // in 2 words
+    be( link, 1ull << 33, 8 ); // no run, 1 literal
+    be( link, 0b10, 8 );      // bit 1
+    be( link, 0, 4 );
+    be( link, 4, 4 );         // replaced: bit 0
+    be( link, 2, 4 );
+    be( link, 1ull << 33, 8 );
+    be( link, 0b01, 8 );
+    be( link, 0, 4 );
+    std::string extension = "link";
+    be( extension, link.size(), 4 );
+
+    boost::filesystem::ofstream( dir / "index", std::ios::binary ) << index( 2, { { "", 0100644 }, { "new.txt", 0100644 } }, extension + link );
+    const std::map<std::string, uint32_t> split = {
+        { "README.md", 0 }, { "new.txt", 7 }, { "src/main.hpp", 12 }, { "sub", 3 }
+    };
+    BOOST_CHECK( read() == split );
+
+    // corrupt
+    boost::filesystem::ofstream( dir / "index", std::ios::binary ) << index( 2, entries, "" ).substr( 0, 100 );
+    BOOST_CHECK( !gitindex::read( dir, []( const gitindex::Entry& ) {} ) );
+    BOOST_CHECK( !gitindex::read( dir / "missing", []( const gitindex::Entry& ) {} ) );
+
+    fs::remove_all( dir );
+}
+
+BOOST_AUTO_TEST_CASE( Test_gitobjects ) {
+
+    fs::path dir = fs::temp_directory_path( ) / "test_gitobjects";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir / "sub" ) );
+
+    const std::string git = "git -C \"" + dir.string() + "\" -c user.name=test -c user.email=test@test ";
+    auto run = [&git]( const std::string & args ) { BOOST_REQUIRE_EQUAL( std::system( ( git + args ).c_str() ), 0 ); };
+
+    std::string big;
+
+    for( size_t i = 0; i < 1000; ++i ) { big += utils::format( "line %d\n", i ); }
+
+    run( "init -q" );
+    run( "symbolic-ref HEAD refs/heads/test" );
+    boost::filesystem::ofstream( dir / "a.txt" ) << "hase\n";
+    boost::filesystem::ofstream( dir / "sub" / "b.txt" ) << "hase\n";
+    boost::filesystem::ofstream( dir / "big.txt" ) << big;
+    run( "add -A" );
+    run( "commit -qm first" );
+
+    // second version of big.txt is stored as delta after repacking
+    boost::filesystem::ofstream( dir / "big.txt" ) << big << "igel\n";
+    run( "commit -qam second" );
+    run( "tag -a v1 -m v1" );
+    run( "repack -adq" );
+
+    // loose objects
+    boost::filesystem::ofstream( dir / "a.txt" ) << "igel\n";
+    run( "commit -qam third" );
+
+    const gitobjects::Repo repo( dir / ".git" );
+
+    auto files = [&repo]( const std::string & rev ) {
+        std::map<std::string, std::string> content;
+        gitobjects::Oid oid;
+        BOOST_REQUIRE( repo.resolve( rev, oid ) );
+
+        BOOST_CHECK( repo.walkTree( oid, [&]( const std::string & path, const gitobjects::Oid & blob, const uint32_t mode ) {
+            BOOST_CHECK_EQUAL( mode, 0100644 );
+            utils::Buffer buffer;
+            BOOST_CHECK( repo.read( blob, buffer ) == gitobjects::Type::Blob );
+            content[path] = std::string( buffer.ptr, buffer.size );
+        } ) );
+
+        return content;
+    };
+
+    const std::map<std::string, std::string> first = { { "a.txt", "hase\n" }, { "big.txt", big }, { "sub/b.txt", "hase\n" } };
+    const std::map<std::string, std::string> second = { { "a.txt", "hase\n" }, { "big.txt", big + "igel\n" }, { "sub/b.txt", "hase\n" } };
+    const std::map<std::string, std::string> third = { { "a.txt", "igel\n" }, { "big.txt", big + "igel\n" }, { "sub/b.txt", "hase\n" } };
+
+    BOOST_CHECK( files( "HEAD" ) == third );
+    BOOST_CHECK( files( "test" ) == third );
+    BOOST_CHECK( files( "refs/heads/test" ) == third );
+    BOOST_CHECK( files( "HEAD^" ) == second );
+    BOOST_CHECK( files( "v1" ) == second );
+    BOOST_CHECK( files( "v1~1" ) == first );
+    BOOST_CHECK( files( "HEAD~2" ) == first );
+
+    // full and abbreviated ids
+    gitobjects::Oid head;
+    gitobjects::Oid oid;
+    BOOST_REQUIRE( repo.resolve( "HEAD", head ) );
+    BOOST_CHECK( repo.resolve( gitobjects::toHex( head ), oid ) && oid == head );
+    BOOST_CHECK( repo.resolve( gitobjects::toHex( head ).substr( 0, 8 ), oid ) && oid == head );
+
+    BOOST_CHECK( !repo.resolve( "missing", oid ) );
+    BOOST_CHECK( !repo.resolve( "HEAD~3", oid ) );
+    BOOST_CHECK( !repo.resolve( "HEAD^2", oid ) );
+
+    BOOST_CHECK_EQUAL( gitobjects::toHex( gitobjects::hashBlob( "hase\n" ) ), "9150b7745508de19a2f60a390f02c8e55ea6ed81" );
+    BOOST_CHECK_EQUAL( gitobjects::toHex( gitobjects::hashBlob( "" ) ), "e69de29bb2d1d6434b8b29ae775ad8c2e48c5391" );
+
+    // worktree against the stat data and blobs of the index
+    auto modified = [&dir]( const std::string & path ) {
+        bool found = false;
+        bool modified = false;
+        gitindex::read( dir / ".git", [&]( const gitindex::Entry & entry ) {
+            if( entry.path != path ) { return; }
+
+            found = true;
+            modified = gitindex::isModified( entry, ( dir / path ).native() );
+        } );
+        BOOST_CHECK( found );
+        return modified;
+    };
+
+    BOOST_CHECK( !modified( "a.txt" ) );
+    boost::filesystem::ofstream( dir / "a.txt" ) << "igel\n"; // same content, new mtime
+    BOOST_CHECK( !modified( "a.txt" ) );
+    boost::filesystem::ofstream( dir / "a.txt" ) << "hase\n";
+    BOOST_CHECK( modified( "a.txt" ) );
+    fs::remove( dir / "sub" / "b.txt" );
+    BOOST_CHECK( modified( "sub/b.txt" ) );
+
+    fs::remove_all( dir );
+}
+
+//! keeps the path of the last collectPrints like the real printers, and records it in printed
+struct PathPrinter : public Printer {
+    sys_string path;
+    std::vector<sys_string>& printed;
+    PathPrinter( const SearchOptions& opts, std::vector<sys_string>& printed ) : Printer( opts ), printed( printed ) {}
+    virtual void collectPrints( const sys_string& path, const std::vector<search::Match>&, const std::string_view& ) override {
+        this->path = path;
+    }
+    virtual void printPrints() override { printed.push_back( path ); }
+};
+
+BOOST_AUTO_TEST_CASE( Test_aliases ) {
+    // files with the same content, like blobs with --rev, are searched once and printed with each path
+    SearchOptions opts;
+    opts.term = "needle";
+    std::vector<sys_string> printed;
+    Searcher searcher( opts, [&opts, &printed] { return new PathPrinter( opts, printed ); } );
+
+    searcher.searchContent( "c.txt", "a needle\n", { "a/x.txt", "b/x.txt" } );
+    BOOST_CHECK( printed == std::vector<sys_string>( { "c.txt", "a/x.txt", "b/x.txt" } ) );
+    BOOST_CHECK_EQUAL( searcher.stats.filesMatched, 3 );
+    BOOST_CHECK_EQUAL( searcher.stats.matches, 3 );
+}
+
+//! records the line number of the first match of each print
+struct LinePrinter : public Printer {
+    size_t line = 0;
+    std::vector<size_t>& printed;
+    LinePrinter( const SearchOptions& opts, std::vector<size_t>& printed ) : Printer( opts ), printed( printed ) {}
+    virtual void collectPrints( const sys_string&, const std::vector<search::Match>& matches, const std::string_view& content ) override {
+        line = skippedLines + std::count( content.cbegin(), matches.front().first, '\n' ) + 1;
+    }
+    virtual void printPrints() override { printed.push_back( line ); }
+};
+
+BOOST_AUTO_TEST_CASE( Test_searchCompressed ) {
+    // outputs larger than a chunk are searched chunk by chunk, with the line numbers of the whole file
+    fs::path dir = fs::temp_directory_path( ) / "test_searchCompressed";
+    fs::remove_all( dir );
+    BOOST_REQUIRE( fs::create_directories( dir ) );
+
+    // lines of 30 bytes, so the chunks end within a line
+    const std::string line = "igel igel igel igel igel igel\n";
+    std::string block;
+
+    for( size_t i = 0; i < 1_MB / line.size(); ++i ) { block += line; }
+
+    const size_t blocks = Searcher::chunkSize / 1_MB * 3 / 2;
+    const size_t lines = blocks * ( 1_MB / line.size() );
+    fs::path test = dir / "test.log.gz";
+
+    {
+        boost::filesystem::ofstream file( test, std::ios::binary );
+        boost::iostreams::filtering_ostream out;
+        out.push( boost::iostreams::gzip_compressor() );
+        out.push( file );
+        out << "needle\n";
+
+        for( size_t i = 0; i < blocks; ++i ) { out << block; }
+
+        out << "needle\n";
+
+        for( size_t i = 0; i < blocks; ++i ) { out << block; }
+
+        out << "needle";
+    }
+
+    SearchOptions opts;
+    opts.term = "needle";
+    opts.decompress = true;
+    std::vector<size_t> printed;
+    Searcher searcher( opts, [&opts, &printed] { return new LinePrinter( opts, printed ); } );
+
+    // the printers are thread local, so a new thread gets one of this searcher
+    std::thread( [&searcher, &test] { searcher.search( test.native() ); } ).join();
+    BOOST_CHECK( printed == std::vector<size_t>( { 1, lines + 2, 2 * lines + 3 } ) );
+    BOOST_CHECK_EQUAL( searcher.stats.filesMatched, 1 );
+    BOOST_CHECK_EQUAL( searcher.stats.matches, 3 );
+    fs::remove_all( dir );
+}
+
 BOOST_AUTO_TEST_CASE( Test_recurseGit ) {
 
-    // must be in within repo
-    const fs::path dir = "test_recurseGit";
+    // like git ls-files -co --exclude-standard: tracked files from the index, untracked ones from the walk
+    fs::path dir = fs::temp_directory_path( ) / "test_recurseGit";
     fs::remove_all( dir );
     BOOST_REQUIRE( fs::create_directories( dir ) );
 
+    const std::string git = "git -C \"" + dir.string() + "\" ";
+    auto run = [&git]( const std::string & args ) { BOOST_REQUIRE_EQUAL( std::system( ( git + args ).c_str() ), 0 ); };
+
     std::string content = "hase";
+    run( "init -q" );
 
     for( size_t i = 0; i < 100; ++i ) {
         boost::filesystem::ofstream( dir / utils::format( "test%02d.cpp", i ) ) << content;
     }
 
+    boost::filesystem::ofstream( dir / ".gitignore" ) << "*.o\n";
+    boost::filesystem::ofstream( dir / "ignored.o" ) << content;
+    run( "add \"test0*.cpp\"" );
+
+    std::set<std::string> tracked;
+    BOOST_REQUIRE( gitindex::read( gitindex::gitDir( dir ), [&tracked]( const gitindex::Entry & entry ) {
+        tracked.insert( entry.path );
+    } ) );
+    BOOST_CHECK_EQUAL( tracked.size(), 10 );
+
+    struct {
+        void add( const std::function<void()>& job ) { job(); }
+    } pool;
+
+    const sys_string root = dir.native();
     size_t counter = 0;
 
-    utils::gitLsFiles( dir, [&]( const sys_string & filename ) {
+    auto onFile = [&]( const sys_string & filename ) {
+        if( gitignore::isIgnoreFile( filename ) ) { return; }
+
         ++counter;
         utils::FileView view = utils::fromFileP( filename );
         BOOST_CHECK_EQUAL( std::string( view.content ), content );
+    };
+
+    for( const std::string& path : tracked ) { onFile( ( dir / path ).native() ); }
+
+    gitignore::recurseDirParallel( pool, root, root.size() + 1, gitignore::fromRepo( dir ), [&]( const sys_string & filename ) {
+        if( !tracked.count( gitignore::relative( filename, root.size() + 1 ) ) ) { onFile( filename ); }
     } );
 
     BOOST_CHECK_EQUAL( counter, 100 );
+    fs::remove_all( dir );
 }
 
 #if 0